@@ -17,7 +17,11 @@
 #include <csignal>
 
 
+#include "execution.h"
 #include "frvt11.h"
+#include "io_probe.h"
+#include "perf_counters.h"
+#include "trace.h"
 #include "util.h"
 
 using namespace std;
@@ -29,6 +33,7 @@ readTemplateFromFile(
         const string &filename,
         vector<uint8_t> &templ)
 {
+    TraceScope trace("readTemplate");
     streampos fileSize;
     ifstream file(filename, std::ios::binary);
 
@@ -87,13 +92,13 @@ createTemplate(
                 cerr << "Failed to load image file: " << imagePath << "." << endl;
                 raise(SIGTERM);
             }
-            image.description = mapStringToImgLabel[desc];
+            image.description = toImageDescription(desc);
             faces.push_back(image);
         }
 
         vector<uint8_t> templ;
         vector<EyePair> eyes;
-        auto ret = implPtr->createFaceTemplate(faces, role, templ, eyes);
+        auto ret = perfCall("createFaceTemplate", [&] { return implPtr->createFaceTemplate(faces, role, templ, eyes); });
         
         /* Check that function is implemented */
         if (ret.code == ReturnCode::NotImplemented) {
@@ -180,11 +185,11 @@ createMultiTemplates(
             cerr << "[ERROR] Failed to load image file: " << imagePath << "." << endl;
             raise(SIGTERM);
         }
-        image.description = mapStringToImgLabel[desc];
+        image.description = toImageDescription(desc);
 
         vector<vector<uint8_t>> templs;
         vector<EyePair> eyes;
-        auto ret = implPtr->createFaceTemplate(image, role, templs, eyes);
+        auto ret = perfCall("createFaceTemplate", [&] { return implPtr->createFaceTemplate(image, role, templs, eyes); });
 
         /* Check that function is implemented */
         if (ret.code == ReturnCode::NotImplemented) {
@@ -279,7 +284,7 @@ match(
         }
 
         /* Call match */
-        auto ret = implPtr->matchTemplates(verifTempl, enrollTempl, similarity);
+        auto ret = perfCall("matchTemplates", [&] { return implPtr->matchTemplates(verifTempl, enrollTempl, similarity); });
 
         /* Write to scores log file */
         scoresStream << enrollID << " "
@@ -297,12 +302,43 @@ match(
     return SUCCESS;
 }
 
+/* --io-only: load the images or templates of one input line as the
+ * action does, without calling the implementation */
+void
+loadOnly(
+        Action action,
+        const string &line,
+        const string &templatesDir,
+        IOProbe &probe)
+{
+    auto tokens = split(line, ' ');
+    if (tokens.empty())
+        return;
+    if (action == Action::Match) {
+        vector<uint8_t> templ;
+        for (unsigned int i = 0; i < 2 && i < tokens.size(); i++) {
+            string templFile{templatesDir + "/" + tokens[i]};
+            probe.load(templFile, [&] {
+                return (readTemplateFromFile(templFile, templ) == SUCCESS); });
+        }
+        return;
+    }
+
+    Image image;
+    for (unsigned int i = 0; i < (tokens.size() - 1)/2; i++) {
+        string imagePath = tokens[(i*2)+1];
+        probe.load(imagePath, [&] { return readImage(imagePath, image); });
+    }
+}
+
 void usage(const string &executable)
 {
     cerr << "Usage: " << executable << " createTemplate -x enroll|verif -c configDir "
-            "-o outputDir -h outputStem -i inputFile -t numForks -j templatesDir" << endl;
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() <<
+            " -j templatesDir" << endl;
     cerr << "       " << executable << " match -c configDir "
-                "-o outputDir -h outputStem -i inputFile -t numForks -j templatesDir" << endl;
+                "-o outputDir -h outputStem -i inputFile " << executionUsage() <<
+                " -j templatesDir" << endl;
     exit(EXIT_FAILURE);
 }
 
@@ -311,7 +347,6 @@ main(
         int argc,
         char* argv[])
 {
-    auto exitStatus = SUCCESS;
 
     uint16_t currAPIMajorVersion{6},
 		currAPIMinorVersion{0},
@@ -352,7 +387,7 @@ main(
         inputFile,
         templatesDir,
 	roleStr{""};
-    int numForks = 1;
+    ExecutionOptions execution;
 
     for (int i = 0; i < argc - requiredArgs; i++) {
         if (strcmp(argv[requiredArgs+i],"-c") == 0)
@@ -365,11 +400,9 @@ main(
             inputFile = argv[requiredArgs+(++i)];
         else if (strcmp(argv[requiredArgs+i],"-j") == 0)
             templatesDir = argv[requiredArgs+(++i)];
-        else if (strcmp(argv[requiredArgs+i],"-t") == 0)
-            numForks = atoi(argv[requiredArgs+(++i)]);
         else if (strcmp(argv[requiredArgs+i],"-x") == 0)
 	    roleStr = argv[requiredArgs+(++i)];
-        else {
+        else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
             cerr << "[ERROR] Unrecognized flag: " << argv[requiredArgs+i] << endl;;
             usage(argv[0]);
         }
@@ -398,79 +431,48 @@ main(
     	}
     }
 
-    /* Get implementation pointer */
-    auto implPtr = Interface::getImplementation();
-    /* Initialization */
-    auto ret = implPtr->initialize(configDir);
-    if (ret.code != ReturnCode::Success) {
-        cerr << "[ERROR] initialize() returned error: "
-                << ret.code << "." << endl;
-        return FAILURE;
+    /* Get implementation pointer; --io-only never calls it */
+    std::shared_ptr<Interface> implPtr;
+    if (!execution.ioOnly) {
+        implPtr = Interface::getImplementation();
+        /* Initialization */
+        auto ret = implPtr->initialize(configDir);
+        if (ret.code != ReturnCode::Success) {
+            cerr << "[ERROR] initialize() returned error: "
+                    << ret.code << "." << endl;
+            return FAILURE;
+        }
     }
 
-    /* Split input file into appropriate number of splits */
-    vector<string> inputFileVector;
-    if (splitInputFile(inputFile, outputDir, numForks, inputFileVector) != SUCCESS) {
-        cerr << "[ERROR] An error occurred with processing the input file." << endl;
+    /* Run the requested action on one input split */
+    auto runAction = [&](const string &inputFile, int i) -> int {
+        if (execution.ioOnly)
+            return loadInputOnly(inputFile, ioProbePath(outputDir, i),
+                [&](const string &line, IOProbe &probe) {
+                    loadOnly(action, line, templatesDir, probe); });
+        else if (action == Action::CreateTemplate)
+            return createTemplate(
+                    implPtr,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                    templatesDir,
+                    role);
+        else if (action == Action::CreateMultiTemplates)
+            return createMultiTemplates(
+                    implPtr,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                    templatesDir,
+                    role);
+        else if (action == Action::Match)
+            return match(
+                    implPtr,
+                    inputFile,
+                    templatesDir,
+                    outputDir + "/" + outputFileStem + ".log." + to_string(i));
         return FAILURE;
-    }
-    
-    bool parent = false;
-	int i = 0;
-    for (auto &inputFile : inputFileVector) {
-		/* Fork */
-		switch(fork()) {
-		case 0: /* Child */
-			if (action == Action::CreateTemplate)
-				return createTemplate(
-						implPtr,
-						inputFile,
-						outputDir + "/" + outputFileStem + ".log." + to_string(i),
-						templatesDir,
-						role);
-            else if (action == Action::CreateMultiTemplates)
-                return createMultiTemplates(
-                        implPtr,
-                        inputFile,
-                        outputDir + "/" + outputFileStem + ".log." + to_string(i),
-                        templatesDir,
-                        role);
-			else if (action == Action::Match)
-				return match(
-						implPtr,
-						inputFile,
-						templatesDir,
-						outputDir + "/" + outputFileStem + ".log." + to_string(i));
-		case -1: /* Error */
-			cerr << "Problem forking" << endl;
-			break;
-		default: /* Parent */
-			parent = true;
-			break;
-		}
-		i++;
-	}
-
-
-    /* Parent -- wait for children */
-    if (parent) {
-        while (numForks > 0) {
-            int stat_val;
-            pid_t cpid;
-
-            cpid = wait(&stat_val);
-            if (WIFEXITED(stat_val)) { exitStatus = WEXITSTATUS(stat_val); }
-            else if (WIFSIGNALED(stat_val)) {
-                cerr << "PID " << cpid << " exited due to signal " <<
-                        WTERMSIG(stat_val) << endl;
-                exitStatus = FAILURE;
-            } else {
-                cerr << "PID " << cpid << " exited with unknown status." << endl;
-                exitStatus = FAILURE;
-            }
-            numForks--;
-        }
-    }
+    };
 
-    return exitStatus;
+    return runWorkers(inputFile, outputDir, execution, runAction,
+            {MergeOutput(outputDir + "/" + outputFileStem + ".log")});
 }
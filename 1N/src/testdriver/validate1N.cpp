@@ -19,7 +19,12 @@
 #include <unistd.h>
 #include <csignal>
 
+#include "checkpoint.h"
+#include "execution.h"
 #include "frvt1N.h"
+#include "io_probe.h"
+#include "perf_counters.h"
+#include "trace.h"
 #include "util.h"
 
 using namespace std;
@@ -36,7 +41,10 @@ enroll(shared_ptr<Interface> &implPtr,
     const string &outputLog,
     const string &edb,
     const string &manifest,
-    const Modality &modality)
+    const Modality &modality,
+    const string &checkpointFile,
+    uint64_t checkpointInterval,
+    bool resume)
 {
     /* Read input file */
     ifstream inputStream(inputFile);
@@ -45,36 +53,59 @@ enroll(shared_ptr<Interface> &implPtr,
 	raise(SIGTERM);
     }
 
+    /* Pick up after the last checkpoint when resuming */
+    Checkpoint checkpoint(checkpointFile, inputFile, {outputLog, edb, manifest},
+        checkpointInterval);
+    streamoff offset;
+    bool resumed = checkpoint.start(resume, offset);
+    if (checkpoint.hasFailed()) {
+        /* Keep the interrupted run's outputs for a rerun with the original -t */
+        inputStream.close();
+        return FAILURE;
+    }
+    if (resumed && checkpoint.isComplete()) {
+        inputStream.close();
+        if( remove(inputFile.c_str()) != 0 )
+            cerr << "Error deleting file: " << inputFile << endl;
+        return SUCCESS;
+    }
+    inputStream.seekg(offset);
+    /* ate, so tellp() below is the EDB offset when appending */
+    auto mode = (resumed ? ios::app | ios::ate : ios::out);
+
     /* Open output log for writing */
-    ofstream logStream(outputLog);
+    ofstream logStream(outputLog, mode);
     if (!logStream.is_open()) {
         cerr << "Failed to open stream for " << outputLog << "." << endl;
         raise(SIGTERM);
     }
 
     /* header */
-    if (modality == Modality::Face)
-        logStream << "id image templateSizeBytes returnCode isLeftEyeAssigned "
-            "isRightEyeAssigned xleft yleft xright yright" << endl;
-    else if (modality == Modality::Iris)
-        logStream << "id image templateSizeBytes returnCode "
-            "limbusCenterX limbusCenterY pupilRadius limbusRadius" << endl; 
-    else if (modality == Modality::MM)
-        logStream << "id image templateSizeBytes returnCode " << endl;
+    if (!resumed) {
+        if (modality == Modality::Face)
+            logStream << "id image templateSizeBytes returnCode isLeftEyeAssigned "
+                "isRightEyeAssigned xleft yleft xright yright" << endl;
+        else if (modality == Modality::Iris)
+            logStream << "id image templateSizeBytes returnCode "
+                "limbusCenterX limbusCenterY pupilRadius limbusRadius" << endl; 
+        else if (modality == Modality::MM)
+            logStream << "id image templateSizeBytes returnCode " << endl;
+    }
 
     /* Open EDB file for writing */
-    ofstream edbStream(edb);
+    ofstream edbStream(edb, mode | ios::binary);
     if (!edbStream.is_open()) {
         cerr << "Failed to open stream for " << edb << "." << endl;
         raise(SIGTERM);
     }
 
     /* Open manifest for writing */
-    ofstream manifestStream(manifest);
+    ofstream manifestStream(manifest, mode);
     if (!manifestStream.is_open()) {
         cerr << "Failed to open stream for " << manifest << "." << endl;
         raise(SIGTERM);
     }
+    const vector<ostream*> outputStreams{&logStream, &edbStream, &manifestStream};
 
     string id, line;
     FRVT::ReturnStatus ret;
@@ -95,7 +126,7 @@ enroll(shared_ptr<Interface> &implPtr,
                 cerr << "Failed to load image file: " << imagePath << "." << endl;
                 raise(SIGTERM);
             }
-            image.description = mapStringToImgLabel[desc];
+            image.description = toImageDescription(desc);
             images.push_back(image);
         }
 
@@ -104,16 +135,16 @@ enroll(shared_ptr<Interface> &implPtr,
         vector<IrisAnnulus> irisLocations;
 
         if (modality == Modality::Face)
-            ret = implPtr->createFaceTemplate(images, TemplateRole::Enrollment_1N, templ, eyes);
+            ret = perfCall("createFaceTemplate", [&] { return implPtr->createFaceTemplate(images, TemplateRole::Enrollment_1N, templ, eyes); });
         else if (modality == Modality::Iris) {
             if (images.size() == 2) {
                 images[0].irisLR = Image::IrisLR::LeftIris;
                 images[1].irisLR = Image::IrisLR::RightIris;
             }
-            ret = implPtr->createIrisTemplate(images, TemplateRole::Enrollment_1N, templ, irisLocations);
+            ret = perfCall("createIrisTemplate", [&] { return implPtr->createIrisTemplate(images, TemplateRole::Enrollment_1N, templ, irisLocations); });
         }
         else if (modality == Modality::MM)
-            ret = implPtr->createFaceAndIrisTemplate(images, TemplateRole::Enrollment_1N, templ);
+            ret = perfCall("createFaceAndIrisTemplate", [&] { return implPtr->createFaceAndIrisTemplate(images, TemplateRole::Enrollment_1N, templ); });
             
         /* If function is not implemented, clean up and exit */
         if (ret.code == ReturnCode::NotImplemented) {
@@ -121,12 +152,15 @@ enroll(shared_ptr<Interface> &implPtr,
         }
 
         /* Write to edb and manifest */
-        manifestStream << id << " "
-                << templ.size() << " "
-                << edbStream.tellp() << endl;
-        edbStream.write(
-                (char*)templ.data(),
-                templ.size());
+        {
+            TraceScope trace("writeEnrollment");
+            manifestStream << id << " "
+                    << templ.size() << " "
+                    << edbStream.tellp() << endl;
+            edbStream.write(
+                    (char*)templ.data(),
+                    templ.size());
+        }
 
         if (modality == Modality::Face) {
             if (images.size() != eyes.size()) {
@@ -162,7 +196,10 @@ enroll(shared_ptr<Interface> &implPtr,
             }
             logStream << endl;
         }
+        checkpoint.update(inputStream, outputStreams);
     }
+    if (ret.code != ReturnCode::NotImplemented)
+        checkpoint.finish(outputStreams);
     inputStream.close();
 
     /* Remove the input file */
@@ -280,10 +317,10 @@ searchAndLog(
 
     /* If a valid search template was generated */
     if (templGenRet.code == ReturnCode::Success) {
-        ret = implPtr->identifyTemplate(
+        ret = perfCall("identifyTemplate", [&] { return implPtr->identifyTemplate(
                 templ,
                 candListLength,
-                candidateList);
+                candidateList); });
         if (ret.code != ReturnCode::Success) {
             /* Populate candidate list with null entries */
             candidateList.resize(candListLength, Candidate(false, "NA", -1.0));
@@ -298,6 +335,7 @@ searchAndLog(
         checkCandidateList(id, candidateList, candListLength, modality);
 
     /* Write to candidate list file */
+    TraceScope trace("writeCandidates");
     int i{0};
     for (const auto& candidate : candidateList)
         candListStream << id << " " << i++ << " "
@@ -314,7 +352,10 @@ search(shared_ptr<Interface> &implPtr,
     const string &inputFile,
     const string &candList,
     const Action &action,
-    const Modality &modality)
+    const Modality &modality,
+    const string &checkpointFile,
+    uint64_t checkpointInterval,
+    bool resume)
 {
     /* Read probes */
     ifstream inputStream(inputFile);
@@ -323,14 +364,33 @@ search(shared_ptr<Interface> &implPtr,
        	raise(SIGTERM); 
     }
 
+    /* Pick up after the last checkpoint when resuming */
+    Checkpoint checkpoint(checkpointFile, inputFile, {candList}, checkpointInterval);
+    streamoff offset;
+    bool resumed = checkpoint.start(resume, offset);
+    if (checkpoint.hasFailed()) {
+        /* Keep the interrupted run's outputs for a rerun with the original -t */
+        inputStream.close();
+        return FAILURE;
+    }
+    if (resumed && checkpoint.isComplete()) {
+        inputStream.close();
+        if( remove(inputFile.c_str()) != 0 )
+            cerr << "Error deleting file: " << inputFile << endl;
+        return SUCCESS;
+    }
+    inputStream.seekg(offset);
+
     /* Open candidate list log for writing */
-    ofstream candListStream(candList);
+    ofstream candListStream(candList, (resumed ? ios::app : ios::out));
     if (!candListStream.is_open()) {
         cerr << "Failed to open stream for " << candList << "." << endl;
         raise(SIGTERM);
     }
     /* header */
-    candListStream << candListHeader << endl;
+    if (!resumed)
+        candListStream << candListHeader << endl;
+    const vector<ostream*> outputStreams{&candListStream};
 
     /* Process each probe */
     string id, imagePath, desc, line;
@@ -351,7 +411,7 @@ search(shared_ptr<Interface> &implPtr,
                 cerr << "Failed to load image file: " << imagePath << "." << endl;
                 raise(SIGTERM);
             }
-            image.description = mapStringToImgLabel[desc];
+            image.description = toImageDescription(desc);
             images.push_back(image);
         }
 
@@ -360,11 +420,11 @@ search(shared_ptr<Interface> &implPtr,
         if (action == Action::Search_1N) {
             vector<uint8_t> templ;
             if (modality == Modality::Face)
-                ret = implPtr->createFaceTemplate(images, TemplateRole::Search_1N, templ, eyes);
+                ret = perfCall("createFaceTemplate", [&] { return implPtr->createFaceTemplate(images, TemplateRole::Search_1N, templ, eyes); });
             else if (modality == Modality::Iris)
-                ret = implPtr->createIrisTemplate(images, TemplateRole::Search_1N, templ, irisLocations);
+                ret = perfCall("createIrisTemplate", [&] { return implPtr->createIrisTemplate(images, TemplateRole::Search_1N, templ, irisLocations); });
             else if (modality == Modality::MM)
-                ret = implPtr->createFaceAndIrisTemplate(images, TemplateRole::Search_1N, templ);
+                ret = perfCall("createFaceAndIrisTemplate", [&] { return implPtr->createFaceAndIrisTemplate(images, TemplateRole::Search_1N, templ); });
                 
             /* If function is not implemented, clean up and exit */
             if (ret.code == ReturnCode::NotImplemented) {
@@ -380,7 +440,7 @@ search(shared_ptr<Interface> &implPtr,
             }
 
             std::vector<std::vector<uint8_t>> templs;
-            auto ret = implPtr->createFaceTemplate(images[0], TemplateRole::Search_1N, templs, eyes);
+            auto ret = perfCall("createFaceTemplate", [&] { return implPtr->createFaceTemplate(images[0], TemplateRole::Search_1N, templs, eyes); });
             /* If function is not implemented, clean up and exit */
             if (ret.code == ReturnCode::NotImplemented) {
                 break;
@@ -392,7 +452,10 @@ search(shared_ptr<Interface> &implPtr,
                 searchAndLog(implPtr, templID, templs[i], candListStream, ret, modality);            
             }
         }
+        checkpoint.update(inputStream, outputStreams);
     }
+    if (ret.code != ReturnCode::NotImplemented)
+        checkpoint.finish(outputStreams);
     inputStream.close();
 
     /* Remove the input file */
@@ -409,10 +472,26 @@ search(shared_ptr<Interface> &implPtr,
     return SUCCESS;
 }
 
+/* --io-only: load the images of one input line as enroll and search do,
+ * without calling the implementation */
+void
+loadOnly(
+    const string &line,
+    IOProbe &probe)
+{
+    auto tokens = split(line, ' ');
+    Image image;
+    for (unsigned int i = 0; i < tokens.size()/2; i++) {
+        string imagePath = tokens[(i*2)+1];
+        probe.load(imagePath, [&] { return readImage(imagePath, image); });
+    }
+}
+
 void usage(const string &executable)
 {
     cerr << "Usage: " << executable << " face|iris|mm enroll_1N|finalize_1N|search_1N|searchMulti_1N -c configDir -e enrollDir "
-            "-o outputDir -h outputStem -i inputFile -t numForks" << endl;
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() <<
+            " [-p checkpointInterval] [-r]" << endl;
     exit(EXIT_FAILURE);
 }
 
@@ -496,7 +575,11 @@ main(int argc, char* argv[])
     	outputDir{"output"},
     	outputFileStem{"stem"},
     	inputFile;
-    int numForks = 1;
+    ExecutionOptions execution;
+    /* Records between checkpoints of each worker, and whether to resume
+     * an interrupted run from them */
+    uint64_t checkpointInterval{1000};
+    bool resume{false};
 
     for (int i = 0; i < argc - requiredArgs; i++) {
         if (strcmp(argv[requiredArgs+i],"-c") == 0)
@@ -509,9 +592,11 @@ main(int argc, char* argv[])
             outputFileStem = argv[requiredArgs+(++i)];
         else if (strcmp(argv[requiredArgs+i],"-i") == 0)
             inputFile = argv[requiredArgs+(++i)];
-        else if (strcmp(argv[requiredArgs+i],"-t") == 0)
-            numForks = atoi(argv[requiredArgs+(++i)]);
-        else {
+        else if (strcmp(argv[requiredArgs+i],"-p") == 0)
+            checkpointInterval = strtoull(argv[requiredArgs+(++i)], nullptr, 10);
+        else if (strcmp(argv[requiredArgs+i],"-r") == 0)
+            resume = true;
+        else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
             cerr << "Unrecognized flag: " << argv[requiredArgs+i] << endl;;
             usage(argv[0]);
         }
@@ -540,73 +625,68 @@ main(int argc, char* argv[])
             usage(argv[0]);
     }
 
-    auto implPtr = Interface::getImplementation();
+    if (execution.ioOnly && action == Action::Finalize_1N) {
+        cerr << "[ERROR] --io-only applies to actions that read an input file." << endl;
+        usage(argv[0]);
+    }
+
+    /* --io-only never calls the implementation */
+    shared_ptr<Interface> implPtr;
+    if (!execution.ioOnly)
+        implPtr = Interface::getImplementation();
     if (action == Action::Enroll_1N || action == Action::Search_1N || action == Action::SearchMulti_1N) {
         /* Initialization */
-        if (initialize(implPtr, configDir, enrollDir, action) != EXIT_SUCCESS)
+        if (!execution.ioOnly &&
+                initialize(implPtr, configDir, enrollDir, action) != EXIT_SUCCESS)
             return EXIT_FAILURE;
 
-        /* Split input file into appropriate number of splits */
-        vector<string> inputFileVector;
-        if (splitInputFile(inputFile, outputDir, numForks, inputFileVector) != EXIT_SUCCESS) {
-            cerr << "An error occurred with processing the input file." << endl;
-            return EXIT_FAILURE;
+        /* Run the requested action on one input split; map lookups
+         * are done up front since workers may be threads */
+        auto actionName = mapActionToString[action];
+        auto runAction = [&](const string &inputFile, int i) -> int {
+            if (execution.ioOnly)
+                return loadInputOnly(inputFile, ioProbePath(outputDir, i), loadOnly);
+            else if (action == Action::Enroll_1N)
+                return enroll(
+                        implPtr,
+                        configDir,
+                        inputFile,
+                        outputDir + "/" + outputFileStem + "." + actionName + "." + to_string(i),
+                        outputDir + "/edb." + to_string(i),
+                        outputDir + "/manifest." + to_string(i),
+                        modality,
+                        outputDir + "/checkpoint." + to_string(i),
+                        checkpointInterval,
+                        resume);
+            return search(
+                    implPtr,
+                    configDir,
+                    enrollDir,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + "." + actionName + "." + to_string(i),
+                    action,
+                    modality,
+                    outputDir + "/checkpoint." + to_string(i),
+                    checkpointInterval,
+                    resume);
+        };
+
+        /* Enrollment also writes EDB and manifest parts, which merge into
+         * the edb and manifest that finalize_1N reads */
+        vector<MergeOutput> outputs{
+            MergeOutput(outputDir + "/" + outputFileStem + "." + actionName)};
+        if (action == Action::Enroll_1N) {
+            outputs.emplace_back(outputDir + "/edb", MergeFormat::Concatenate);
+            outputs.emplace_back(outputDir + "/manifest", MergeFormat::Manifest, 0,
+                outputDir + "/edb");
         }
+        ExecutionReport report;
+        exitStatus = runWorkers(inputFile, outputDir, execution, runAction, outputs, &report);
 
-        bool parent = false;
-        int i = 0;
-        for (auto &inputFile : inputFileVector) {
-            /* Fork */
-            switch(fork()) {
-            case 0: /* Child */
-                if (action == Action::Enroll_1N)
-                    return enroll(
-                            implPtr,
-                            configDir,
-                            inputFile,
-                            outputDir + "/" + outputFileStem + "." + mapActionToString[action] + "." + to_string(i),
-                            outputDir + "/edb." + to_string(i),
-                            outputDir + "/manifest." + to_string(i),
-                            modality);
-                else if (action == Action::Search_1N || action == Action::SearchMulti_1N)
-                    return search(
-                            implPtr,
-                            configDir,
-                            enrollDir,
-                            inputFile,
-                            outputDir + "/" + outputFileStem + "." + mapActionToString[action] + "." + to_string(i),
-                            action,
-                            modality);
-            case -1: /* Error */
-                cerr << "Problem forking" << endl;
-                break;
-            default: /* Parent */
-                parent = true;
-                break;
-            }
-            i++;
-        }
-
-        /* Parent -- wait for children */
-        if (parent) {
-            while (numForks > 0) {
-                int stat_val;
-                pid_t cpid;
-
-                cpid = wait(&stat_val);
-                if (WIFEXITED(stat_val)) { exitStatus = WEXITSTATUS(stat_val); }
-                else if (WIFSIGNALED(stat_val)) {
-                    cerr << "PID " << cpid << " exited due to signal " <<
-                    WTERMSIG(stat_val) << endl;
-                    exitStatus = FAILURE;
-                } else {
-                    cerr << "PID " << cpid << " exited with unknown status." << endl;
-                    exitStatus = FAILURE;
-                }
-
-                numForks--;
-            }
-        }
+        /* Checkpoints are kept until every worker has finished */
+        if (exitStatus != FAILURE)
+            for (int i = 0; i < report.numWorkers; i++)
+                remove((outputDir + "/checkpoint." + to_string(i)).c_str());
     } else if (action == Action::Finalize_1N) {
         return finalize(implPtr, outputDir, enrollDir, configDir);
     } 
@@ -84,6 +84,91 @@ public:
 	const FRVT::Media &faceTwo,
         double &age) = 0;
 
+    /**
+     * @brief This function processes the faceOne media of the two-media
+     * estimateAge() once and returns an opaque reference template, so
+     * that one reference paired with many later captures need not be
+     * re-processed for every pairing.  The template is passed back to
+     * estimateAgeFromReference() unchanged, within the same process.
+     *
+     * This function is optional.  The default implementation returns
+     * ReturnCode::NotImplemented, in which case the two-media
+     * estimateAge() is used for every pairing.
+     *
+     * @param[in] faceOne
+     * Input media of an image or a sequential video frames of one person.
+     * @param[in] ageOne
+     * The age of the person in faceOne.
+     * @param[out] referenceTemplate
+     * Implementation-defined representation of faceOne and ageOne.
+     */
+    virtual FRVT::ReturnStatus
+    createReferenceTemplate(
+        const FRVT::Media &faceOne,
+        const double &ageOne,
+        std::vector<uint8_t> &referenceTemplate)
+    {
+        return FRVT::ReturnStatus(FRVT::ReturnCode::NotImplemented);
+    }
+
+    /**
+     * @brief This function is equivalent to the two-media estimateAge(),
+     * with faceOne and ageOne given by a template from
+     * createReferenceTemplate().  It must be implemented if
+     * createReferenceTemplate() is.
+     *
+     * @param[in] referenceTemplate
+     * Output of createReferenceTemplate().
+     * @param[in] faceTwo
+     * Input media of an image or a sequential video frames of one person.
+     * @param[out] age
+     * An age estimation of the face in faceTwo.  The legal values are [0,100]
+     */
+    virtual FRVT::ReturnStatus
+    estimateAgeFromReference(
+        const std::vector<uint8_t> &referenceTemplate,
+        const FRVT::Media &faceTwo,
+        double &age)
+    {
+        return FRVT::ReturnStatus(FRVT::ReturnCode::NotImplemented);
+    }
+
+    /**
+     * @brief This function is the batched form of estimateAge(face, age).
+     * It takes a batch of media, typically single images, and outputs an
+     * age estimate and return status for each one, which lets inference
+     * engines amortize per-call overhead.
+     *
+     * The default implementation calls the single-media estimateAge()
+     * for each media in the batch.  Implementations that can process
+     * batches natively should override this function.
+     *
+     * @param[in] faces
+     * Input media, each of one person.
+     * @param[out] ages
+     * One age estimate per input media, in the same order.  The legal
+     * values are [0,100]
+     * @param[out] statuses
+     * One return status per input media, in the same order
+     *
+     * @return
+     * ReturnCode::Success if the batch was processed (per-media failures
+     * are reported in statuses); an error code if the batch as a whole
+     * could not be processed
+     */
+    virtual FRVT::ReturnStatus
+    estimateAgeBatch(
+        const std::vector<FRVT::Media> &faces,
+        std::vector<double> &ages,
+        std::vector<FRVT::ReturnStatus> &statuses)
+    {
+        ages.assign(faces.size(), -1.0);
+        statuses.resize(faces.size());
+        for (size_t i = 0; i < faces.size(); i++)
+            statuses[i] = this->estimateAge(faces[i], ages[i]);
+        return FRVT::ReturnStatus(FRVT::ReturnCode::Success);
+    }
+
      /**
      * @brief This function returns a binary decision on whether the face in the image is above an age threshold.  
      * This function prototype allows an implementation to invoke specialized processing for certain age groups.  
@@ -103,6 +188,71 @@ public:
         const double &ageThreshold,
         bool &isAboveThreshold) = 0;
 
+    /**
+     * @brief This function is the multi-threshold form of verifyAge().  It
+     * returns one decision per age threshold for the same media, so that
+     * an implementation can compute shared features once.
+     *
+     * The default implementation calls the single-threshold verifyAge()
+     * for each threshold.
+     *
+     * @param[in] face
+     * Input media of an image or a sequential video frames of one person.
+     * @param[in] ageThresholds
+     * Input ages of interest.
+     * @param[out] isAboveThreshold
+     * One decision per entry of ageThresholds, in the same order; true
+     * if the face is above that age threshold, false otherwise.
+     */
+    virtual FRVT::ReturnStatus
+    verifyAgeThresholds(
+        const FRVT::Media &face,
+        const std::vector<double> &ageThresholds,
+        std::vector<bool> &isAboveThreshold)
+    {
+        isAboveThreshold.assign(ageThresholds.size(), false);
+        for (size_t i = 0; i < ageThresholds.size(); i++) {
+            bool decision{false};
+            auto ret = this->verifyAge(face, ageThresholds[i], decision);
+            if (ret.code != FRVT::ReturnCode::Success)
+                return ret;
+            isAboveThreshold[i] = decision;
+        }
+        return FRVT::ReturnStatus(FRVT::ReturnCode::Success);
+    }
+
+    /**
+     * @brief This function estimates the age of the face in the media and
+     * returns a decision for each of several age thresholds, so that an
+     * implementation can derive all of them from a single inference.
+     *
+     * The default implementation calls estimateAge() and then
+     * verifyAgeThresholds().  Implementations that compute a shared
+     * representation should override this function.
+     *
+     * @param[in] face
+     * Input media of an image or a sequential video frames of one person.
+     * @param[in] ageThresholds
+     * Input ages of interest.
+     * @param[out] age
+     * An age estimation of the face; the legal values are [0,100]
+     * @param[out] isAboveThreshold
+     * One decision per entry of ageThresholds, in the same order; true
+     * if the face is above that age threshold, false otherwise.
+     */
+    virtual FRVT::ReturnStatus
+    estimateAndVerifyAge(
+        const FRVT::Media &face,
+        const std::vector<double> &ageThresholds,
+        double &age,
+        std::vector<bool> &isAboveThreshold)
+    {
+        auto ret = this->estimateAge(face, age);
+        if (ret.code != FRVT::ReturnCode::Success)
+            return ret;
+        return this->verifyAgeThresholds(face, ageThresholds, isAboveThreshold);
+    }
+
     /**
      * @brief
      * Factory method to return a managed pointer to the Interface object.
@@ -135,7 +285,7 @@ extern uint16_t API_MINOR_VERSION;
 /** API major version number. */
 uint16_t API_MAJOR_VERSION{1};
 /** API minor version number. */
-uint16_t API_MINOR_VERSION{0};
+uint16_t API_MINOR_VERSION{4};
 #endif /* NIST_EXTERN_API_VERSION */
 }
 
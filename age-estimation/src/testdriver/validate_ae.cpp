@@ -8,6 +8,9 @@
  * about its pad, reliability, or any other characteristic.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <cstring>
@@ -19,38 +22,333 @@
 #include <iomanip>
 #include <sstream>
 
+#include "execution.h"
 #include "frvt_ae.h"
+#include "io_probe.h"
+#include "lru_cache.h"
+#include "perf_counters.h"
 #include "util.h"
 
 using namespace std;
 using namespace FRVT;
 using namespace FRVT_AE;
 
-FRVT::Media createMedia(
-    const string &inputImagePaths,
-    const string &imageDesc){
+/* Which frames of a video entry are passed to the implementation */
+struct FrameSampling {
+    enum class Policy {
+        /** Every frame */
+        All,
+        /** Every Nth frame */
+        Stride,
+        /** At most N frames, evenly spaced over the clip */
+        MaxN,
+        /** The N sharpest frames (Laplacian variance), in temporal order */
+        Sharpness
+    };
+
+    Policy policy;
+    unsigned int value;
+
+    FrameSampling() :
+        policy{Policy::All},
+        value{0}
+        {}
+};
+
+/* Parse all, stride:N, max:N, or sharp:N */
+bool
+parseFrameSampling(
+    const string &spec,
+    FrameSampling &sampling)
+{
+    auto tokens = split(spec, ':');
+    if (tokens.size() == 1 && tokens[0] == "all") {
+        sampling = FrameSampling();
+        return true;
+    }
+    if (tokens.size() != 2 || atoi(tokens[1].c_str()) <= 0)
+        return false;
+    sampling.value = atoi(tokens[1].c_str());
+    if (tokens[0] == "stride")
+        sampling.policy = FrameSampling::Policy::Stride;
+    else if (tokens[0] == "max")
+        sampling.policy = FrameSampling::Policy::MaxN;
+    else if (tokens[0] == "sharp")
+        sampling.policy = FrameSampling::Policy::Sharpness;
+    else
+        return false;
+    return true;
+}
 
-    FRVT::Media media;
-    Image image;
+/* Variance of the 4-neighbour Laplacian of the image luminance */
+double
+laplacianVariance(const Image &image)
+{
+    if (image.width < 3 || image.height < 3)
+        return 0;
+    const size_t channels = image.depth / 8;
+    const uint8_t *pixels = image.data.get();
+    auto luma = [&](size_t x, size_t y) -> int {
+        const uint8_t *p = pixels + (y * image.width + x) * channels;
+        return (channels == 3 ? (299 * p[0] + 587 * p[1] + 114 * p[2]) / 1000 : p[0]);
+    };
+
+    double sum{0}, sumSquares{0};
+    size_t count{0};
+    for (size_t y = 1; y + 1 < image.height; y++)
+        for (size_t x = 1; x + 1 < image.width; x++) {
+            double l = 4 * luma(x, y) - luma(x - 1, y) - luma(x + 1, y) -
+                luma(x, y - 1) - luma(x, y + 1);
+            sum += l;
+            sumSquares += l * l;
+            count++;
+        }
+    double mean = sum / count;
+    return (sumSquares / count - mean * mean);
+}
+
+/* Decode inputImagePaths into media, reusing its frames and pixel buffers
+ * from the previous line; returns the number of frames before sampling.
+ * With probe, every frame decode is timed for --io-only. */
+size_t
+fillMedia(
+    const string &inputImagePaths,
+    const string &imageDesc,
+    const FrameSampling &sampling,
+    FRVT::Media &media,
+    IOProbe *probe = nullptr)
+{
     auto imagePathTokens = split(inputImagePaths, ',');
-    auto numImages = imagePathTokens.size();
-    for (unsigned int i=0; i<numImages; i++) {
-        string imagePath = imagePathTokens[i];
-        if (!readImage(imagePath, image)) {
+    auto numFrames = imagePathTokens.size();
+
+    /* Stride and max-N are chosen before decoding, so skipped frames
+     * are never read */
+    size_t step{1}, numImages{numFrames};
+    if (numFrames > 1 && sampling.policy == FrameSampling::Policy::Stride) {
+        step = sampling.value;
+        numImages = (numFrames + step - 1) / step;
+    } else if (numFrames > sampling.value &&
+            sampling.policy == FrameSampling::Policy::MaxN)
+        numImages = sampling.value;
+
+    auto description = toImageDescription(imageDesc);
+    media.data.resize(numImages);
+    for (size_t i = 0; i < numImages; i++) {
+        const auto &imagePath = imagePathTokens[numImages < numFrames && step == 1 ?
+            i * numFrames / numImages : i * step];
+        if (probe != nullptr)
+            probe->load(imagePath, [&] { return readImage(imagePath, media.data[i]); });
+        else if (!readImage(imagePath, media.data[i])) {
             cerr << "Failed to load image file: " << imagePath << "." << endl;
             raise(SIGTERM);
         }
-        image.description = mapStringToImgLabel[imageDesc];
-        media.data.push_back(image);
+        media.data[i].description = description;
+    }
+
+    /* Sharpness needs the pixels, so frames are dropped after decoding */
+    if (numImages > sampling.value &&
+            sampling.policy == FrameSampling::Policy::Sharpness) {
+        vector<pair<double, size_t>> ranked;
+        for (size_t i = 0; i < numImages; i++)
+            ranked.emplace_back(laplacianVariance(media.data[i]), i);
+        std::partial_sort(ranked.begin(), ranked.begin() + sampling.value,
+            ranked.end(), [](const pair<double, size_t> &a,
+                const pair<double, size_t> &b) { return a.first > b.first; });
+        vector<size_t> keep;
+        for (size_t i = 0; i < sampling.value; i++)
+            keep.push_back(ranked[i].second);
+        std::sort(keep.begin(), keep.end());
+        /* Kept frames move towards the front in order, so none is
+         * overwritten before it is moved */
+        for (size_t i = 0; i < keep.size(); i++)
+            if (keep[i] != i)
+                media.data[i] = std::move(media.data[keep[i]]);
+        media.data.resize(keep.size());
     }
-    if (numImages > 1) {
+
+    if (numFrames > 1) {
         media.type = FRVT::Media::Label::Video;
-        media.fps = 30;
+        /* Effective frame rate of the sampled frames */
+        media.fps = std::max<size_t>(1, (30 * media.data.size() + numFrames / 2) / numFrames);
     }
     else{
         media.type = FRVT::Media::Label::Image; 
+        media.fps = 0;
+    }
+    return numFrames;
+}
+
+/* Two-media estimateAge() reference, processed once per worker */
+struct Reference {
+    /* Output of createReferenceTemplate(), if the implementation has it */
+    bool hasTemplate;
+    vector<uint8_t> referenceTemplate;
+    /* Decoded faceOne otherwise */
+    FRVT::Media media;
+    size_t framesIn, framesUsed;
+
+    Reference() :
+        hasTemplate{false},
+        framesIn{0},
+        framesUsed{0}
+        {}
+};
+
+/* Two-media estimateAge() with faceOne taken from, or added to, cache.
+ * useTemplates is cleared once createReferenceTemplate() reports
+ * NotImplemented, after which decoded media are cached instead. */
+ReturnStatus
+estimateAgeWithReference(
+    std::shared_ptr<Interface> &implPtr,
+    LRUCache<string, Reference> &cache,
+    bool &useTemplates,
+    const vector<string> &tokens,
+    const FrameSampling &sampling,
+    FRVT::Media &mediaTwo,
+    double &estimateAge,
+    size_t &framesIn,
+    size_t &framesUsed)
+{
+    /* A reference template may depend on ageOne as well as the media */
+    auto key = tokens[1] + " " + tokens[3];
+    double imageOneAge = stod(tokens[3]);
+    const Reference *reference = cache.get(key);
+    Reference created;
+    if (reference == nullptr) {
+        created.framesIn = fillMedia(tokens[1], tokens[2], sampling, created.media);
+        created.framesUsed = created.media.data.size();
+        if (useTemplates) {
+            auto ret = perfCall("createReferenceTemplate", [&] { return implPtr->createReferenceTemplate(created.media,
+                imageOneAge, created.referenceTemplate); });
+            if (ret.code == ReturnCode::NotImplemented)
+                useTemplates = false;
+            else if (ret.code != ReturnCode::Success)
+                return ret;
+            else {
+                /* Only the template is needed from now on */
+                created.hasTemplate = true;
+                created.media.data.clear();
+            }
+        }
+
+        uint64_t cost = sizeof(Reference) + created.referenceTemplate.size();
+        for (const auto &image : created.media.data)
+            cost += image.size();
+        cache.put(key, created, cost);
+        reference = &created;
+    }
+
+    framesIn = reference->framesIn + fillMedia(tokens[4], tokens[5], sampling, mediaTwo);
+    framesUsed = reference->framesUsed + mediaTwo.data.size();
+    if (reference->hasTemplate)
+        return perfCall("estimateAgeFromReference", [&] { return implPtr->estimateAgeFromReference(reference->referenceTemplate, mediaTwo, estimateAge); });
+    return perfCall("estimateAge", [&] { return implPtr->estimateAge(reference->media, imageOneAge, mediaTwo, estimateAge); });
+}
+
+/* Per-worker latency and accuracy summary */
+struct AgeStats {
+    vector<double> latencies;
+    size_t framesIn, framesUsed, numTruth;
+    double absErrorSum;
+    /* Decisions with ground truth, and how many were right, per threshold */
+    vector<size_t> numDecisions, numCorrect;
+
+    AgeStats() :
+        framesIn{0},
+        framesUsed{0},
+        numTruth{0},
+        absErrorSum{0}
+        {}
+
+    void
+    add(
+        double seconds,
+        size_t framesIn,
+        size_t framesUsed)
+    {
+        this->latencies.push_back(seconds * 1000);
+        this->framesIn += framesIn;
+        this->framesUsed += framesUsed;
+    }
+
+    /* Accumulate absolute error if ground truth is known for id */
+    void
+    addError(
+        const map<string, double> &groundTruth,
+        const string &id,
+        double age)
+    {
+        auto it = groundTruth.find(id);
+        if (it == groundTruth.end())
+            return;
+        this->absErrorSum += std::abs(age - it->second);
+        this->numTruth++;
+    }
+
+    /* Check each threshold decision against the true age, if known for
+     * id; a face is above a threshold if its true age is greater */
+    void
+    addDecisions(
+        const map<string, double> &groundTruth,
+        const string &id,
+        const vector<double> &ageThresholds,
+        const vector<bool> &isAboveThreshold)
+    {
+        auto it = groundTruth.find(id);
+        if (it == groundTruth.end())
+            return;
+        this->numDecisions.resize(ageThresholds.size(), 0);
+        this->numCorrect.resize(ageThresholds.size(), 0);
+        for (size_t t = 0; t < ageThresholds.size(); t++) {
+            this->numDecisions[t]++;
+            if (isAboveThreshold[t] == (it->second > ageThresholds[t]))
+                this->numCorrect[t]++;
+        }
+    }
+
+    void
+    report(
+        const string &outputLog,
+        const vector<double> &ageThresholds = {})
+    {
+        if (this->latencies.empty())
+            return;
+        std::sort(this->latencies.begin(), this->latencies.end());
+        double sum{0};
+        for (const auto &latency : this->latencies)
+            sum += latency;
+        cerr << "[INFO] " << outputLog << ": " << this->latencies.size()
+            << " media, " << this->framesUsed << " of " << this->framesIn
+            << " frames used, latency mean " << sum / this->latencies.size()
+            << " ms, p50 " << this->latencies[this->latencies.size() / 2]
+            << " ms, p95 " << this->latencies[this->latencies.size() * 95 / 100]
+            << " ms";
+        if (this->numTruth > 0)
+            cerr << ", MAE " << this->absErrorSum / this->numTruth << " over "
+                << this->numTruth << " media with ground truth";
+        for (size_t t = 0; t < this->numDecisions.size(); t++)
+            cerr << ", threshold " << ageThresholds[t] << " accuracy "
+                << 100.0 * this->numCorrect[t] / this->numDecisions[t] << "% over "
+                << this->numDecisions[t] << " media";
+        cerr << "." << endl;
+    }
+};
+
+/* Read "id age" lines */
+map<string, double>
+readGroundTruth(const string &truthFile)
+{
+    map<string, double> groundTruth;
+    ifstream truthStream(truthFile);
+    if (!truthStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << truthFile << "." << endl;
+        raise(SIGTERM);
     }
-    return media;
+    string id;
+    double age;
+    while (truthStream >> id >> age)
+        groundTruth[id] = age;
+    return groundTruth;
 }
 
 int
@@ -58,7 +356,10 @@ runEstimateAge(
     std::shared_ptr<Interface> &implPtr,
     const string &inputFile,
     const string &outputLog,
-    const bool hasTwoMedia)
+    const bool hasTwoMedia,
+    const FrameSampling &sampling,
+    const map<string, double> &groundTruth,
+    uint64_t referenceCacheBytes)
 {
     /* Read input file */
     ifstream inputStream(inputFile);
@@ -79,22 +380,37 @@ runEstimateAge(
 
     string id, line;
     ReturnStatus ret;
+    AgeStats stats;
+    /* Reused across lines so frame vectors and pixel buffers are not
+     * reallocated for every record */
+    FRVT::Media media, mediaOne, mediaTwo;
+    LRUCache<string, Reference> cache(referenceCacheBytes);
+    bool useTemplates{true};
     while (std::getline(inputStream, line)) {
         double estimateAge{-1.0};
         auto tokens = split(line, ' ');
         id = tokens[0];
-     	if (hasTwoMedia){
-	    string mediaOnedesc = tokens[2];
-	    FRVT::Media mediaOne = createMedia(tokens[1], mediaOnedesc);
+        auto start = chrono::steady_clock::now();
+        size_t framesIn{0}, framesUsed{0};
+        if (hasTwoMedia && referenceCacheBytes > 0)
+            ret = estimateAgeWithReference(implPtr, cache, useTemplates,
+                tokens, sampling, mediaTwo, estimateAge, framesIn, framesUsed);
+     	else if (hasTwoMedia){
+	    framesIn = fillMedia(tokens[1], tokens[2], sampling, mediaOne);
 	    double imageOneAge = stod(tokens[3]);
-	    string mediaTwodesc = tokens[5];
-	    FRVT::Media mediaTwo = createMedia(tokens[4], mediaTwodesc);;
-	    ret = implPtr->estimateAge(mediaOne, imageOneAge, mediaTwo, estimateAge);
+	    framesIn += fillMedia(tokens[4], tokens[5], sampling, mediaTwo);
+	    ret = perfCall("estimateAge", [&] { return implPtr->estimateAge(mediaOne, imageOneAge, mediaTwo, estimateAge); });
+            framesUsed = mediaOne.data.size() + mediaTwo.data.size();
 	}
 	else{
-	    FRVT::Media media = createMedia(tokens[1], tokens[2]);
-            ret = implPtr->estimateAge(media, estimateAge);
+	    framesIn = fillMedia(tokens[1], tokens[2], sampling, media);
+            ret = perfCall("estimateAge", [&] { return implPtr->estimateAge(media, estimateAge); });
+            framesUsed = media.data.size();
         }
+        stats.add(chrono::duration<double>(chrono::steady_clock::now() - start).count(),
+                framesIn, framesUsed);
+        if (ret.code == ReturnCode::Success)
+            stats.addError(groundTruth, id, estimateAge);
 
 	if (ret.code == ReturnCode::NotImplemented) {
             cerr << "[ERROR] The estimageAge(face, age) function returned ReturnCode::NotImplemented.  This function must be implemented!" << std::endl;
@@ -109,6 +425,13 @@ runEstimateAge(
             << std::endl;
     }
     inputStream.close();
+    stats.report(outputLog);
+    if (referenceCacheBytes > 0)
+        cerr << "[INFO] " << outputLog << ": reference cache "
+                << cache.getHits() << " hits, " << cache.getMisses() << " misses, "
+                << cache.getEvictions() << " evictions ("
+                << (useTemplates ? "reference templates" : "decoded media")
+                << ")." << endl;
 
     /* Remove the input file */
     if( remove(inputFile.c_str()) != 0 )
@@ -125,12 +448,140 @@ runEstimateAge(
 }
 
 
+/* Log one batch of single-media estimates and add them to stats, each
+ * with an equal share of the call's latency; returns the batch status */
+ReturnStatus
+logEstimateAgeBatch(
+    std::shared_ptr<Interface> &implPtr,
+    const vector<string> &ids,
+    const vector<FRVT::Media> &medias,
+    const vector<size_t> &framesIn,
+    const map<string, double> &groundTruth,
+    AgeStats &stats,
+    ofstream &logStream,
+    double &apiSeconds)
+{
+    vector<double> ages;
+    vector<ReturnStatus> statuses;
+    auto start = chrono::steady_clock::now();
+    auto ret = perfCall("estimateAgeBatch", [&] { return implPtr->estimateAgeBatch(medias, ages, statuses); });
+    auto seconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+    apiSeconds += seconds;
+    if (ret.code != ReturnCode::Success) {
+        /* Treat a failed batch as every media failing */
+        ages.assign(medias.size(), -1.0);
+        statuses.assign(medias.size(), ret);
+    } else if (ages.size() != medias.size() || statuses.size() != medias.size()) {
+        cerr << "[ERROR] estimateAgeBatch() returned " << ages.size() << " ages and "
+                << statuses.size() << " statuses for " << medias.size()
+                << " media." << endl;
+        raise(SIGTERM);
+    }
+
+    for (size_t i = 0; i < medias.size(); i++) {
+        if (statuses[i].code == ReturnCode::NotImplemented) {
+            cerr << "[ERROR] The estimageAge(face, age) function returned ReturnCode::NotImplemented.  This function must be implemented!" << std::endl;
+            raise(SIGTERM);
+        }
+        stats.add(seconds / medias.size(), framesIn[i], medias[i].data.size());
+        if (statuses[i].code == ReturnCode::Success)
+            stats.addError(groundTruth, ids[i], ages[i]);
+
+        std::stringstream ageEstimate_ss;
+        ageEstimate_ss << std::fixed << std::setprecision(2) << ages[i];
+        logStream << ids[i] << " "
+            << ageEstimate_ss.str() << " "
+            << static_cast<std::underlying_type<ReturnCode>::type>(statuses[i].code) << " "
+            << std::endl;
+    }
+    return ret;
+}
+
+/* Group batchSize single-media lines per call to estimateAgeBatch() */
+int
+runEstimateAgeBatched(
+    std::shared_ptr<Interface> &implPtr,
+    const string &inputFile,
+    const string &outputLog,
+    unsigned int batchSize,
+    const FrameSampling &sampling,
+    const map<string, double> &groundTruth)
+{
+    /* Read input file */
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << inputFile << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* Open output log for writing */
+    ofstream logStream(outputLog);
+    if (!logStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << outputLog << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* header */
+    logStream << "id estimateAge returnCode" << endl;
+
+    /* Batch slots are refilled in place rather than rebuilt */
+    vector<string> ids(batchSize);
+    vector<FRVT::Media> medias(batchSize);
+    vector<size_t> framesIn(batchSize);
+    AgeStats stats;
+    size_t numMedia{0}, filled{0};
+    double apiSeconds{0};
+    auto start = chrono::steady_clock::now();
+    string line;
+    while (true) {
+        bool haveLine = static_cast<bool>(std::getline(inputStream, line));
+        if (haveLine) {
+            auto tokens = split(line, ' ');
+            ids[filled].swap(tokens[0]);
+            framesIn[filled] = fillMedia(tokens[1], tokens[2], sampling, medias[filled]);
+            filled++;
+        }
+        if (filled == batchSize || (!haveLine && filled > 0)) {
+            /* Only the final batch can be short */
+            ids.resize(filled);
+            medias.resize(filled);
+            logEstimateAgeBatch(implPtr, ids, medias, framesIn, groundTruth,
+                    stats, logStream, apiSeconds);
+            numMedia += filled;
+            filled = 0;
+        }
+        if (!haveLine)
+            break;
+    }
+    inputStream.close();
+    stats.report(outputLog);
+
+    double totalSeconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+    if (numMedia > 0)
+        cerr << "[INFO] " << outputLog << ": " << numMedia
+                << " media, batch size " << batchSize << ": "
+                << (apiSeconds > 0 ? numMedia / apiSeconds : 0)
+                << " media/s in estimateAgeBatch calls, "
+                << (totalSeconds > 0 ? numMedia / totalSeconds : 0)
+                << " media/s overall." << endl;
+
+    /* Remove the input file */
+    if( remove(inputFile.c_str()) != 0 )
+        cerr << "Error deleting file: " << inputFile << endl;
+
+    return SUCCESS;
+}
+
 int
 runVerifyAge(
     std::shared_ptr<Interface> &implPtr,
     const string &inputFile,
     const string &outputLog,
-    const double &ageThreshold)
+    const vector<double> &ageThresholds,
+    const FrameSampling &sampling,
+    const map<string, double> &groundTruth)
 {
     /* Read input file */
     ifstream inputStream(inputFile);
@@ -151,25 +602,40 @@ runVerifyAge(
 
     string id, line;
     ReturnStatus ret;
+    AgeStats stats;
+    FRVT::Media media;
+    vector<bool> isAboveThreshold;
     while (std::getline(inputStream, line)) {
-        bool isAboveThreshold;
+        isAboveThreshold.clear();
         auto tokens = split(line, ' ');
         id = tokens[0];
-        FRVT::Media media = createMedia(tokens[1], tokens[2]); 
-        ret = implPtr->verifyAge(media, ageThreshold, isAboveThreshold);
+        /* All thresholds are evaluated against one decoded media */
+        auto start = chrono::steady_clock::now();
+        auto framesIn = fillMedia(tokens[1], tokens[2], sampling, media);
+        ret = perfCall("verifyAgeThresholds", [&] { return implPtr->verifyAgeThresholds(media, ageThresholds, isAboveThreshold); });
+        stats.add(chrono::duration<double>(chrono::steady_clock::now() - start).count(),
+                framesIn, media.data.size());
         
 	if (ret.code == ReturnCode::NotImplemented) {
             cerr << "[ERROR] The estimageAge(face, age) function returned ReturnCode::NotImplemented.  This function must be implemented!" << std::endl;
             raise(SIGTERM);
         }
 
-        logStream << id << " "
-            << ageThreshold << " "
-	    << (isAboveThreshold ? "TRUE" : "FALSE") << " "
-            << static_cast<std::underlying_type<ReturnCode>::type>(ret.code) << " " 
-            << std::endl;
+        if (isAboveThreshold.size() != ageThresholds.size())
+            isAboveThreshold.assign(ageThresholds.size(), false);
+        else if (ret.code == ReturnCode::Success)
+            stats.addDecisions(groundTruth, id, ageThresholds, isAboveThreshold);
+
+        /* One line per threshold */
+        for (size_t t = 0; t < ageThresholds.size(); t++)
+            logStream << id << " "
+                << ageThresholds[t] << " "
+                << (isAboveThreshold[t] ? "TRUE" : "FALSE") << " "
+                << static_cast<std::underlying_type<ReturnCode>::type>(ret.code) << " " 
+                << std::endl;
     }
     inputStream.close();
+    stats.report(outputLog, ageThresholds);
 
     /* Remove the input file */
     if( remove(inputFile.c_str()) != 0 )
@@ -184,10 +650,107 @@ runVerifyAge(
     }
     return SUCCESS;
 }
+int
+runEstimateAndVerifyAge(
+    std::shared_ptr<Interface> &implPtr,
+    const string &inputFile,
+    const string &outputLog,
+    const vector<double> &ageThresholds,
+    const FrameSampling &sampling,
+    const map<string, double> &groundTruth)
+{
+    /* Read input file */
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << inputFile << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* Open output log for writing */
+    ofstream logStream(outputLog);
+    if (!logStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << outputLog << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* header; one decision column per threshold */
+    logStream << "id estimateAge";
+    for (const auto &ageThreshold : ageThresholds)
+        logStream << " isAboveThreshold_" << ageThreshold;
+    logStream << " returnCode" << endl;
+
+    string id, line;
+    ReturnStatus ret;
+    AgeStats stats;
+    FRVT::Media media;
+    vector<bool> isAboveThreshold;
+    while (std::getline(inputStream, line)) {
+        double estimateAge{-1.0};
+        isAboveThreshold.clear();
+        auto tokens = split(line, ' ');
+        id = tokens[0];
+        /* Each media is decoded once for the estimate and all decisions */
+        auto start = chrono::steady_clock::now();
+        auto framesIn = fillMedia(tokens[1], tokens[2], sampling, media);
+        ret = perfCall("estimateAndVerifyAge", [&] { return implPtr->estimateAndVerifyAge(media, ageThresholds,
+                estimateAge, isAboveThreshold); });
+        stats.add(chrono::duration<double>(chrono::steady_clock::now() - start).count(),
+                framesIn, media.data.size());
+        if (ret.code == ReturnCode::Success)
+            stats.addError(groundTruth, id, estimateAge);
+
+        if (ret.code == ReturnCode::NotImplemented) {
+            cerr << "[ERROR] The estimateAndVerifyAge(face, thresholds, age, decisions) function returned ReturnCode::NotImplemented." << std::endl;
+            raise(SIGTERM);
+        }
+        if (isAboveThreshold.size() != ageThresholds.size())
+            isAboveThreshold.assign(ageThresholds.size(), false);
+        else if (ret.code == ReturnCode::Success)
+            stats.addDecisions(groundTruth, id, ageThresholds, isAboveThreshold);
+
+        std::stringstream ageEstimate_ss;
+        ageEstimate_ss << std::fixed << std::setprecision(2) << estimateAge;
+        logStream << id << " " << ageEstimate_ss.str();
+        for (const auto &decision : isAboveThreshold)
+            logStream << " " << (decision ? "TRUE" : "FALSE");
+        logStream << " "
+            << static_cast<std::underlying_type<ReturnCode>::type>(ret.code) << " "
+            << std::endl;
+    }
+    inputStream.close();
+    stats.report(outputLog, ageThresholds);
+
+    /* Remove the input file */
+    if( remove(inputFile.c_str()) != 0 )
+        cerr << "Error deleting file: " << inputFile << endl;
+
+    return SUCCESS;
+}
+
+/* --io-only: decode the media of one input line as the action does,
+ * without calling the implementation */
+void
+loadOnly(
+    const string &line,
+    bool hasTwoMedia,
+    const FrameSampling &sampling,
+    FRVT::Media &media,
+    IOProbe &probe)
+{
+    auto tokens = split(line, ' ');
+    if (tokens.size() >= 3)
+        fillMedia(tokens[1], tokens[2], sampling, media, &probe);
+    if (hasTwoMedia && tokens.size() >= 6)
+        fillMedia(tokens[4], tokens[5], sampling, media, &probe);
+}
+
 void usage(const string &executable)
 {
-    cerr << "Usage: " << executable << " -c configDir "
-            "-o outputDir -h outputStem -i inputFile -t numForks" << endl;
+    cerr << "Usage: " << executable << " estimateAge|verifyAge|estimateAndVerifyAge -c configDir "
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() << " "
+            "[-a ageThreshold[,ageThreshold,...]] [-x hasTwoMedia] "
+            "[-s all|stride:N|max:N|sharp:N] [-g groundTruthFile] "
+            "[-b batchSize] [-k referenceCacheMB]" << endl;
     exit(EXIT_FAILURE);
 }
 
@@ -196,10 +759,9 @@ main(
         int argc,
         char* argv[])
 {
-    auto exitStatus = SUCCESS;
 
     uint16_t currAPIMajorVersion{1},
-        currAPIMinorVersion{0},
+        currAPIMinorVersion{4},
         currStructsMajorVersion{3},
         currStructsMinorVersion{0};
 
@@ -235,9 +797,13 @@ main(
     outputDir{"output"},
     outputFileStem{"stem"},
     inputFile;
-    int numForks = 1;
+    ExecutionOptions execution;
     bool hasTwoMedia = false;
-    double ageThreshold{-1.0};
+    vector<double> ageThresholds;
+    FrameSampling sampling;
+    map<string, double> groundTruth;
+    unsigned int batchSize = 0;
+    uint64_t referenceCacheMB = 0;
 
     for (int i = 0; i < argc - requiredArgs; i++) {
         if (strcmp(argv[requiredArgs+i],"-c") == 0)
@@ -248,13 +814,24 @@ main(
             outputFileStem = argv[requiredArgs+(++i)];
         else if (strcmp(argv[requiredArgs+i],"-i") == 0)
             inputFile = argv[requiredArgs+(++i)];
-        else if (strcmp(argv[requiredArgs+i],"-t") == 0)
-            numForks = atoi(argv[requiredArgs+(++i)]);
-        else if (strcmp(argv[requiredArgs+i],"-a") == 0)
-            ageThreshold = atoi(argv[requiredArgs+(++i)]);
-        else if (strcmp(argv[requiredArgs+i],"-x") == 0)
+        else if (strcmp(argv[requiredArgs+i],"-a") == 0) {
+            /* Comma-separated; every threshold is swept in one pass */
+            for (const auto &threshold : split(argv[requiredArgs+(++i)], ','))
+                ageThresholds.push_back(atoi(threshold.c_str()));
+        } else if (strcmp(argv[requiredArgs+i],"-x") == 0)
             hasTwoMedia = atoi(argv[requiredArgs+(++i)]);
-        else {
+        else if (strcmp(argv[requiredArgs+i],"-s") == 0) {
+            if (!parseFrameSampling(argv[requiredArgs+(++i)], sampling)) {
+                cerr << "[ERROR] Unknown frame sampling policy: " << argv[requiredArgs+i] << endl;
+                usage(argv[0]);
+            }
+        } else if (strcmp(argv[requiredArgs+i],"-g") == 0)
+            groundTruth = readGroundTruth(argv[requiredArgs+(++i)]);
+        else if (strcmp(argv[requiredArgs+i],"-b") == 0)
+            batchSize = atoi(argv[requiredArgs+(++i)]);
+        else if (strcmp(argv[requiredArgs+i],"-k") == 0)
+            referenceCacheMB = atoi(argv[requiredArgs+(++i)]);
+        else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
             cerr << "[ERROR] Unrecognized flag: " << argv[requiredArgs+i] << endl;;
             usage(argv[0]);
         }
@@ -264,80 +841,90 @@ main(
     switch(action) {
         case Action::EstimateAge:
         case Action::VerifyAge:
+        case Action::EstimateAndVerifyAge:
             break;
         default:
             cerr << "Unknown command: " << actionstr << endl;
             usage(argv[0]);
     }
 
-    /* Get implementation pointer */
-    auto implPtr = Interface::getImplementation();
-    /* Initialization */
-    auto ret = implPtr->initialize(configDir);
-    if (ret.code != ReturnCode::Success) {
-        cerr << "[ERROR] initialize() returned error: "
-                << ret.code << "." << endl;
-        return FAILURE;
-    }
-
-    /* Split input file into appropriate number of splits */
-    vector<string> inputFileVector;
-    if (splitInputFile(inputFile, outputDir, numForks, inputFileVector) != SUCCESS) {
-        cerr << "[ERROR] An error occurred with processing the input file." << endl;
-        return FAILURE;
-    }
-
-    bool parent = false;
-    int i = 0;
-    for (auto &inputFile : inputFileVector) {
-        /* Fork */
-        switch(fork()) {
-        case 0: /* Child */
-            switch (action) {
-                case Action::EstimateAge:
-		    return runEstimateAge(
-			implPtr,
-                        inputFile,
-                        outputDir + "/" + outputFileStem + ".log." + to_string(i),
-			hasTwoMedia);
-		case Action::VerifyAge:
-                    return runVerifyAge(
+    if (referenceCacheMB > 0 && !(action == Action::EstimateAge && hasTwoMedia)) {
+        cerr << "[ERROR] -k referenceCacheMB applies only to estimateAge with -x 1" << endl;
+        usage(argv[0]);
+    }
+
+    if (ageThresholds.empty()) {
+        if (action == Action::EstimateAndVerifyAge) {
+            cerr << "[ERROR] estimateAndVerifyAge requires -a ageThreshold[,ageThreshold,...]" << endl;
+            usage(argv[0]);
+        }
+        /* Preserve the previous default for verifyAge */
+        ageThresholds.push_back(-1.0);
+    }
+
+    /* Get implementation pointer; --io-only never calls it */
+    std::shared_ptr<Interface> implPtr;
+    if (!execution.ioOnly) {
+        implPtr = Interface::getImplementation();
+        /* Initialization */
+        auto ret = implPtr->initialize(configDir);
+        if (ret.code != ReturnCode::Success) {
+            cerr << "[ERROR] initialize() returned error: "
+                    << ret.code << "." << endl;
+            return FAILURE;
+        }
+    }
+
+    /* Run the requested action on one input split */
+    auto runAction = [&](const string &inputFile, int i) -> int {
+        if (execution.ioOnly) {
+            /* Reused across lines, as the actions do */
+            FRVT::Media media;
+            return loadInputOnly(inputFile, ioProbePath(outputDir, i),
+                [&](const string &line, IOProbe &probe) {
+                    loadOnly(line, hasTwoMedia && action == Action::EstimateAge,
+                        sampling, media, probe); });
+        }
+        switch (action) {
+            case Action::EstimateAge:
+                /* With -b, single-media entries go through the batched call */
+                if (batchSize > 0 && !hasTwoMedia)
+                    return runEstimateAgeBatched(
                         implPtr,
                         inputFile,
                         outputDir + "/" + outputFileStem + ".log." + to_string(i),
-			ageThreshold);
-                default:
-                    return FAILURE;
-            }
-        case -1: /* Error */
-        cerr << "Problem forking" << endl;
-        break;
-        default: /* Parent */
-            parent = true;
-            break;
-        }
-        i++;
-    }
-
-    /* Parent -- wait for children */
-    if (parent) {
-        while (numForks > 0) {
-            int stat_val;
-            pid_t cpid;
-
-            cpid = wait(&stat_val);
-            if (WIFEXITED(stat_val)) { exitStatus = WEXITSTATUS(stat_val); }
-            else if (WIFSIGNALED(stat_val)) {
-                cerr << "PID " << cpid << " exited due to signal " <<
-                        WTERMSIG(stat_val) << endl;
-                exitStatus = FAILURE;
-            } else {
-                cerr << "PID " << cpid << " exited with unknown status." << endl;
-                exitStatus = FAILURE;
-            }
-            numForks--;
+                        batchSize,
+                        sampling,
+                        groundTruth);
+                return runEstimateAge(
+                    implPtr,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                    hasTwoMedia,
+                    sampling,
+                    groundTruth,
+                    referenceCacheMB * 1024 * 1024);
+            case Action::VerifyAge:
+                return runVerifyAge(
+                    implPtr,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                    ageThresholds,
+                    sampling,
+                    groundTruth);
+            case Action::EstimateAndVerifyAge:
+                return runEstimateAndVerifyAge(
+                    implPtr,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                    ageThresholds,
+                    sampling,
+                    groundTruth);
+            default:
+                return FAILURE;
         }
-    }
+    };
 
-    return exitStatus;
+    return runWorkers(inputFile, outputDir, execution, runAction,
+            {MergeOutput(outputDir + "/" + outputFileStem + ".log")});
 }
@@ -0,0 +1,159 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sched.h>
+#include <sys/stat.h>
+#include <vector>
+
+#include "execution.h"
+#include "util.h"
+
+using namespace std;
+
+/*
+ * Runs the same memory-bound workload through runWorkers() once per
+ * affinity setting, so pinned and unpinned throughput can be compared on
+ * the machine that will run validation.  Each record is one pass over a
+ * buffer private to the worker, standing in for a template or image that
+ * stays resident across calls.
+ */
+
+namespace {
+
+/* Touch one byte per cache line so each pass is bound by memory traffic */
+uint64_t
+pass(vector<uint8_t> &buffer)
+{
+    uint64_t sum{0};
+    for (size_t i = 0; i < buffer.size(); i += 64) {
+        sum += buffer[i];
+        buffer[i] = static_cast<uint8_t>(sum);
+    }
+    return sum;
+}
+
+int
+runRecords(
+    const string &inputFile,
+    const string &logFile,
+    size_t bufferBytes)
+{
+    ifstream inputStream(inputFile);
+    ofstream logStream(logFile);
+    if (!inputStream.is_open() || !logStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << inputFile << " or " << logFile << "." << endl;
+        return FAILURE;
+    }
+
+    /* Allocated and first touched after pinning, so under numa the pages
+     * land on the worker's node */
+    vector<uint8_t> buffer(bufferBytes, 1);
+    uint64_t records{0}, migrations{0}, checksum{0};
+    int cpu = sched_getcpu();
+    auto start = chrono::steady_clock::now();
+    string line;
+    while (std::getline(inputStream, line)) {
+        checksum += pass(buffer);
+        records++;
+        int now = sched_getcpu();
+        if (now != cpu) {
+            migrations++;
+            cpu = now;
+        }
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    logStream << records << " " << migrations << " " << seconds << " " << checksum << endl;
+    return SUCCESS;
+}
+
+}
+
+void usage(const string &executable)
+{
+    cerr << "Usage: " << executable << " -o outputDir " << executionUsage() <<
+            " [-r recordsPerWorker] [-m bufferMB]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+int
+main(
+        int argc,
+        char* argv[])
+{
+    string outputDir;
+    ExecutionOptions execution;
+    uint64_t recordsPerWorker{200};
+    size_t bufferMB{64};
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+            outputDir = argv[++i];
+        else if (strcmp(argv[i],"-r") == 0 && i + 1 < argc)
+            recordsPerWorker = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i],"-m") == 0 && i + 1 < argc)
+            bufferMB = strtoull(argv[++i], nullptr, 10);
+        else if (!parseExecutionFlag(argc, argv, i, execution)) {
+            cerr << "[ERROR] Unrecognized flag: " << argv[i] << endl;
+            usage(argv[0]);
+        }
+    }
+    if (outputDir.empty() || execution.numWorkers() < 1 || recordsPerWorker == 0 || bufferMB == 0)
+        usage(argv[0]);
+    mkdir(outputDir.c_str(), 0755);
+
+    /* One line per record; runWorkers() splits it evenly */
+    string inputFile{outputDir + "/records.txt"};
+    {
+        ofstream inputStream(inputFile);
+        for (uint64_t r = 0; r < recordsPerWorker * execution.numWorkers(); r++)
+            inputStream << r << "\n";
+        if (!inputStream) {
+            cerr << "[ERROR] Failed to write " << inputFile << "." << endl;
+            return FAILURE;
+        }
+    }
+
+    cout << "affinity mode workers records seconds recordsPerSecond migrations" << endl;
+    for (const auto &affinity : {"none", "compact", "scatter", "numa"}) {
+        auto options = execution;
+        options.affinity = mapStringToAffinity[affinity];
+        string prefix{outputDir + "/" + affinity + "."};
+        auto worker = [&](const string &split, int i) {
+            return runRecords(split, prefix + to_string(i), bufferMB << 20);
+        };
+
+        ExecutionReport report;
+        if (runWorkers(inputFile, outputDir, options, worker, {}, &report) != SUCCESS)
+            return FAILURE;
+
+        uint64_t records{0}, migrations{0};
+        for (int i = 0; i < report.numWorkers; i++) {
+            ifstream logStream(prefix + to_string(i));
+            uint64_t workerRecords, workerMigrations;
+            if (!(logStream >> workerRecords >> workerMigrations)) {
+                cerr << "[ERROR] Missing results from worker " << i << "." << endl;
+                return FAILURE;
+            }
+            records += workerRecords;
+            migrations += workerMigrations;
+        }
+        cout << affinity << " " << mapExecutionModeToString[report.mode] << " " <<
+                report.numWorkers << " " << records << " " << fixed << setprecision(3) <<
+                report.seconds << " " << setprecision(1) << records / report.seconds <<
+                " " << migrations << endl;
+        cout.unsetf(ios::fixed);
+    }
+    return SUCCESS;
+}
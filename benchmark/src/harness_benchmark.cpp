@@ -0,0 +1,315 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Measures what the validation drivers themselves cost per record.  Each
+ * driver is built against its null implementation, which does next to
+ * no work, and run over synthetic input; what remains is the harness:
+ * input parsing, image decoding, output logging, and process management.
+ *
+ * Drivers run as child processes with libfrvt_alloc_counter.so preloaded,
+ * so allocations are counted without rebuilding them.  CPU time is the
+ * driver's and its workers' combined user and system time.
+ */
+
+namespace {
+
+const int SUCCESS{0}, FAILURE{1};
+
+/* One driver invocation; record counts of 0 are setup, not reported */
+struct Step {
+    string driver, action;
+    vector<string> args;
+    uint64_t records;
+};
+
+struct Result {
+    double seconds, cpuSeconds;
+    uint64_t allocations, bytes;
+};
+
+bool
+writeImage(
+    const string &path,
+    unsigned int width,
+    unsigned int height,
+    unsigned int seed)
+{
+    ofstream stream(path, ios::binary);
+    stream << "P6\n" << width << " " << height << "\n255\n";
+    vector<uint8_t> row(width * 3);
+    for (unsigned int y = 0; y < height; y++) {
+        for (unsigned int x = 0; x < row.size(); x++)
+            row[x] = static_cast<uint8_t>(x * 7 + y * 13 + seed * 31);
+        stream.write(reinterpret_cast<const char*>(row.data()), row.size());
+    }
+    return static_cast<bool>(stream);
+}
+
+/* Input file with one line per record, line(i) giving the content */
+template<typename Line>
+string
+writeInput(
+    const string &path,
+    uint64_t records,
+    Line line)
+{
+    ofstream stream(path);
+    for (uint64_t i = 0; i < records; i++)
+        stream << line(i) << "\n";
+    return path;
+}
+
+int
+run(
+    const string &binDir,
+    const string &workDir,
+    const string &preload,
+    const Step &step,
+    Result &result)
+{
+    string log{workDir + "/" + step.driver + "." + step.action + ".out"};
+    string counts{workDir + "/" + step.driver + "." + step.action + ".allocs"};
+    remove(counts.c_str());
+
+    auto start = chrono::steady_clock::now();
+    auto pid = fork();
+    if (pid == 0) {
+        int fd = open(log.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        setenv("LD_PRELOAD", preload.c_str(), 1);
+        setenv("FRVT_ALLOC_COUNT_FILE", counts.c_str(), 1);
+        string executable{binDir + "/" + step.args[0]};
+        vector<char*> argv;
+        for (const auto &arg : step.args)
+            argv.push_back(const_cast<char*>(arg.c_str()));
+        argv.push_back(nullptr);
+        execv(executable.c_str(), argv.data());
+        cerr << "[ERROR] Cannot run " << executable << ": " << strerror(errno) << endl;
+        _exit(127);
+    } else if (pid < 0) {
+        cerr << "[ERROR] fork() failed: " << strerror(errno) << endl;
+        return FAILURE;
+    }
+
+    /* The rusage of a reaped child includes the workers it reaped */
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid)
+        return FAILURE;
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+        usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != SUCCESS) {
+        cerr << "[ERROR] " << step.driver << " " << step.action << " failed; see " << log << "." << endl;
+        return FAILURE;
+    }
+
+    /* One line per process: pid allocations bytes */
+    result.allocations = result.bytes = 0;
+    ifstream countStream(counts);
+    uint64_t pidColumn, allocations, bytes;
+    while (countStream >> pidColumn >> allocations >> bytes) {
+        result.allocations += allocations;
+        result.bytes += bytes;
+    }
+    return SUCCESS;
+}
+
+string
+directoryOf(const string &path)
+{
+    auto slash = path.find_last_of('/');
+    return (slash == string::npos ? "." : path.substr(0, slash));
+}
+
+}
+
+void usage(const string &executable)
+{
+    cerr << "Usage: " << executable << " -o workDir [-r records] [-s widthxheight] "
+            "[-k numImages] [-b binDir] [-- driver flags]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+int
+main(
+        int argc,
+        char* argv[])
+{
+    string workDir, binDir{directoryOf(argv[0])};
+    uint64_t records{1000};
+    unsigned int width{480}, height{640}, numImages{16};
+    /* Appended to every driver command line */
+    vector<string> driverFlags;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+            workDir = argv[++i];
+        else if (strcmp(argv[i],"-r") == 0 && i + 1 < argc)
+            records = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i],"-s") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%ux%u", &width, &height) != 2)
+                usage(argv[0]);
+        } else if (strcmp(argv[i],"-k") == 0 && i + 1 < argc)
+            numImages = atoi(argv[++i]);
+        else if (strcmp(argv[i],"-b") == 0 && i + 1 < argc)
+            binDir = argv[++i];
+        else if (strcmp(argv[i],"--") == 0) {
+            driverFlags.assign(argv + i + 1, argv + argc);
+            break;
+        } else {
+            cerr << "[ERROR] Unrecognized flag: " << argv[i] << endl;
+            usage(argv[0]);
+        }
+    }
+    if (workDir.empty() || records == 0 || numImages == 0 || width == 0 || height == 0)
+        usage(argv[0]);
+    if (driverFlags.empty())
+        driverFlags = {"-t", "1"};
+
+    char resolved[PATH_MAX];
+    if (realpath(binDir.c_str(), resolved) == nullptr) {
+        cerr << "[ERROR] Cannot find " << binDir << "." << endl;
+        return FAILURE;
+    }
+    binDir = resolved;
+    string preload{directoryOf(binDir) + "/lib/libfrvt_alloc_counter.so"};
+    if (access(preload.c_str(), R_OK) != 0) {
+        cerr << "[ERROR] Cannot find " << preload << "." << endl;
+        return FAILURE;
+    }
+
+    /* Synthetic images, shared round-robin by the records */
+    for (const auto &dir : {"", "/images", "/config"})
+        mkdir((workDir + dir).c_str(), 0755);
+    vector<string> images;
+    for (unsigned int k = 0; k < numImages; k++) {
+        images.push_back(workDir + "/images/" + to_string(k) + ".ppm");
+        if (!writeImage(images.back(), width, height, k)) {
+            cerr << "[ERROR] Failed to write " << images.back() << "." << endl;
+            return FAILURE;
+        }
+    }
+    auto image = [&](uint64_t i) { return images[i % images.size()]; };
+    auto id = [](uint64_t i) { return "id" + to_string(i); };
+
+    string config{workDir + "/config"};
+    auto input = [&](const string &name, uint64_t n, std::function<string(uint64_t)> line) {
+        return writeInput(workDir + "/" + name + ".txt", n, line);
+    };
+    /* Output directory under workDir, creating its parents as needed */
+    auto output = [&](const string &name) {
+        string dir{workDir + "/" + name};
+        for (auto slash = dir.find('/', workDir.size() + 1); slash != string::npos;
+                slash = dir.find('/', slash + 1))
+            mkdir(dir.substr(0, slash).c_str(), 0755);
+        mkdir(dir.c_str(), 0755);
+        return dir;
+    };
+
+    auto faces = input("faces", records,
+        [&](uint64_t i) { return id(i) + " " + image(i) + " faceunknown"; });
+    auto templatePairs = input("template-pairs", records,
+        [&](uint64_t i) { return id(i) + ".template " + id((i + 1) % records) + ".template"; });
+    auto fiveMedia = input("five-media", records,
+        [&](uint64_t i) { return id(i) + "|image " + image(i) + " unknown"; });
+    auto morphImages = input("morph-images", records,
+        [&](uint64_t i) { return image(i); });
+    auto imagePairs = input("image-pairs", records,
+        [&](uint64_t i) { return image(i / 4) + " " + image(i); });
+
+    vector<Step> steps{
+        {"11", "createTemplate", {"validate11", "createTemplate", "-x", "enroll",
+            "-c", config, "-o", output("11"), "-h", "s", "-i", faces,
+            "-j", output("11/templates")}, records},
+        {"11", "match", {"validate11", "match", "-c", config, "-o", output("11"),
+            "-h", "m", "-i", templatePairs, "-j", workDir + "/11/templates"}, records},
+        {"1N", "enroll_1N", {"validate1N", "face", "enroll_1N", "-c", config,
+            "-e", output("1N/enroll"), "-o", output("1N"), "-h", "s", "-i", faces,
+            "--merge"}, records},
+        {"1N", "finalize_1N", {"validate1N", "face", "finalize_1N", "-c", config,
+            "-e", workDir + "/1N/enroll", "-o", workDir + "/1N", "-h", "s"}, 0},
+        {"1N", "search_1N", {"validate1N", "face", "search_1N", "-c", config,
+            "-e", workDir + "/1N/enroll", "-o", workDir + "/1N", "-h", "s", "-i", faces},
+            records},
+        {"five", "enroll_1N", {"validate_five", "enroll_1N", "-c", config,
+            "-e", output("five/enroll"), "-o", output("five"), "-h", "s", "-i", fiveMedia,
+            "--merge"}, records},
+        {"five", "finalize_1N", {"validate_five", "finalize_1N", "-c", config,
+            "-e", workDir + "/five/enroll", "-o", workDir + "/five", "-h", "s"}, 0},
+        {"five", "search_1N", {"validate_five", "search_1N", "-c", config,
+            "-e", workDir + "/five/enroll", "-o", workDir + "/five", "-h", "s",
+            "-i", fiveMedia}, records},
+        {"morph", "detectNonScannedMorph", {"validate_morph", "detectNonScannedMorph",
+            "-c", config, "-o", output("morph"), "-h", "d", "-i", morphImages}, records},
+        {"morph", "compare", {"validate_morph", "compare", "-c", config,
+            "-o", output("morph"), "-h", "c", "-i", imagePairs}, records},
+        {"quality", "vectorQ", {"validate_quality", "vectorQ", "-c", config,
+            "-o", output("quality"), "-h", "s", "-i", faces}, records},
+        {"quality-enrollment", "qualityGatedEnroll_1N", {"validate_quality_enrollment",
+            "qualityGatedEnroll_1N", "-c", config, "-o", output("quality-enrollment"),
+            "-h", "s", "-i", faces, "--merge"}, records},
+        {"age-estimation", "estimateAge", {"validate_ae", "estimateAge", "-c", config,
+            "-o", output("age-estimation"), "-h", "s", "-i", faces}, records},
+    };
+
+    cout << "driver action records seconds recordsPerSecond cpuMicrosecondsPerRecord "
+            "allocationsPerRecord allocatedBytesPerRecord" << endl;
+    int exitStatus{SUCCESS};
+    string skipped;
+    for (auto &step : steps) {
+        /* Benchmark whichever drivers were built */
+        if (access((binDir + "/" + step.args[0]).c_str(), X_OK) != 0) {
+            if (skipped != step.driver)
+                cerr << "[INFO] " << step.args[0] << " not built; skipping." << endl;
+            skipped = step.driver;
+            continue;
+        }
+        step.args.insert(step.args.end(), driverFlags.begin(), driverFlags.end());
+
+        Result result;
+        if (run(binDir, workDir, preload, step, result) != SUCCESS) {
+            exitStatus = FAILURE;
+            continue;
+        }
+        if (step.records == 0)
+            continue;
+        double n = step.records;
+        cout << step.driver << " " << step.action << " " << step.records << " "
+                << fixed << setprecision(3) << result.seconds << " "
+                << setprecision(1) << n / result.seconds << " "
+                << result.cpuSeconds * 1e6 / n << " "
+                << result.allocations / n << " "
+                << setprecision(0) << result.bytes / n << endl;
+        cout.unsetf(ios::fixed);
+    }
+    return exitStatus;
+}
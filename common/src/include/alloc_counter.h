@@ -0,0 +1,35 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef ALLOC_COUNTER_H_
+#define ALLOC_COUNTER_H_
+
+#include <cstdint>
+
+/*
+ * alloc_counter.cpp replaces the global operator new to count heap
+ * allocations.  Linking it into an executable counts that executable's
+ * allocations (and those of the libraries it loads); building it as a
+ * shared library and loading it with LD_PRELOAD counts them for an
+ * unmodified executable.  Counts restart at zero in a fork()ed child.
+ *
+ * If the environment variable FRVT_ALLOC_COUNT_FILE names a file, each
+ * process appends "pid allocations bytes" to it on exit.
+ */
+
+/** @brief Number of operator new calls in this process */
+uint64_t
+allocationCount();
+
+/** @brief Bytes requested through operator new in this process */
+uint64_t
+allocatedBytes();
+
+#endif /* ALLOC_COUNTER_H_ */
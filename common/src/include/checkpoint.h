@@ -0,0 +1,119 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * Progress of one worker through its input split, so that an
+ * interrupted run can resume where it left off.
+ *
+ * @details
+ * Every interval records, update() flushes the worker's output streams
+ * and writes the input offset after the last complete record together
+ * with the size of every output at that point.  The checkpoint is
+ * written to a temporary file and renamed over the previous one, so a
+ * worker killed mid-write leaves the last good checkpoint in place.
+ * When resuming, start() truncates the outputs back to the
+ * checkpointed sizes, dropping any partial record written after it.
+ *
+ * The input split is identified by its size, so resuming requires the
+ * same input file and number of workers as the interrupted run.
+ */
+class Checkpoint {
+public:
+    /**
+     * @param[in] path
+     * Checkpoint file
+     * @param[in] inputFile
+     * Input split the worker reads
+     * @param[in] outputs
+     * Files the worker writes, in a fixed order
+     * @param[in] interval
+     * Number of records between checkpoints; 0 disables checkpoints
+     */
+    Checkpoint(
+        const std::string &path,
+        const std::string &inputFile,
+        const std::vector<std::string> &outputs,
+        uint64_t interval);
+
+    /**
+     * @brief Restores the last checkpoint, if resuming and there is one
+     * for this input split, truncating the outputs to their checkpointed
+     * sizes.  Otherwise, any stale checkpoint is removed.
+     *
+     * @param[in] resume
+     * Whether the run is resuming an interrupted one
+     * @param[out] offset
+     * Input offset to continue reading from
+     *
+     * @return
+     * true if the worker should resume (open outputs for appending and
+     * skip headers); false if it should start from the beginning, or,
+     * if hasFailed(), not run at all
+     */
+    bool
+    start(
+        bool resume,
+        std::streamoff &offset);
+
+    /** @brief Whether start() found a checkpoint it could not restore
+     * (e.g., for a different input split), so that starting over would
+     * overwrite the interrupted run's outputs */
+    bool
+    hasFailed() const { return this->failed; }
+
+    /** @brief Whether the restored checkpoint marks the split finished */
+    bool
+    isComplete() const { return this->complete; }
+
+    /**
+     * @brief Counts one complete record, and checkpoints every
+     * interval records.
+     *
+     * @param[in] input
+     * Input stream, positioned after the record
+     * @param[in] streams
+     * Output streams, in the same order as the outputs
+     */
+    void
+    update(
+        std::istream &input,
+        const std::vector<std::ostream*> &streams);
+
+    /** @brief Checkpoints the split as finished */
+    void
+    finish(const std::vector<std::ostream*> &streams);
+
+    /** @brief Number of records completed, including restored ones */
+    uint64_t
+    getRecords() const { return this->records; }
+
+private:
+    bool
+    write(
+        std::streamoff offset,
+        const std::vector<std::ostream*> &streams);
+
+    std::string path, inputFile;
+    std::vector<std::string> outputs;
+    uint64_t interval, records;
+    bool complete;
+    bool failed;
+};
+
+#endif /* CHECKPOINT_H_ */
@@ -0,0 +1,368 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef EXECUTION_H_
+#define EXECUTION_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief
+ * How runWorkers() runs the workers
+ */
+enum class ExecutionMode {
+    /** One fork()ed process per worker, each with its own copy of the
+     * initialized implementation */
+    Process,
+    /** One thread per worker, all sharing the initialized
+     * implementation, which must then support concurrent calls */
+    Thread
+};
+
+/**
+ * @brief
+ * Mapping from ExecutionMode to string
+ */
+extern std::map<ExecutionMode, std::string> mapExecutionModeToString;
+
+/**
+ * @brief
+ * How workers are pinned to CPUs.  Worker N always gets the same CPUs
+ * for a given setting and machine.
+ */
+enum class Affinity {
+    /** Workers are left to the scheduler */
+    None,
+    /** One CPU per worker, filling the physical cores of one socket
+     * before the next, and SMT siblings only once every core is used */
+    Compact,
+    /** One CPU per worker, alternating sockets, and SMT siblings only
+     * once every core is used */
+    Scatter,
+    /** All CPUs of one NUMA node per worker, nodes taken round-robin, so
+     * memory a worker allocates stays node-local */
+    NUMA
+};
+
+/**
+ * @brief
+ * Mapping from string to Affinity
+ */
+extern std::map<std::string, Affinity> mapStringToAffinity;
+
+/**
+ * @brief
+ * Work-stealing thread pool.
+ *
+ * @details
+ * Each thread owns a queue of tasks.  submit() deals tasks round-robin
+ * across the queues; a thread takes work from the back of its own
+ * queue and, when that is empty, steals from the front of the others.
+ * Stealing only balances load when there are more tasks than threads.
+ */
+class ThreadPool {
+public:
+    /**
+     * @param[in] numThreads
+     * Number of worker threads (at least one is started)
+     */
+    explicit ThreadPool(unsigned int numThreads);
+
+    /** Runs any remaining tasks and joins the threads. */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /** @brief Queue a task to run on one of the threads. */
+    void
+    submit(std::function<void()> task);
+
+    /** @brief Block until every submitted task has finished. */
+    void
+    wait();
+
+    /** @brief Number of worker threads */
+    size_t
+    size() const { return this->threads.size(); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void
+    run(size_t self);
+
+    bool
+    take(
+        size_t self,
+        std::function<void()> &task);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable available, idle;
+    /* Tasks queued but not yet taken, and tasks not yet finished */
+    size_t queued, pending;
+    size_t nextQueue;
+    bool stopping;
+};
+
+/**
+ * @brief
+ * Execution settings shared by all validation drivers
+ */
+struct ExecutionOptions {
+    /** Number of processes to fork (-t) */
+    int numForks;
+    /** Number of threads (-n); when non-zero, overrides numForks */
+    int numThreads;
+    /** CPU pinning of workers (--affinity) */
+    Affinity affinity;
+    /** Merge per-worker outputs once all workers finish (--merge) */
+    bool merge;
+    /** Only load the input, without calling the implementation, and
+     * report the load rate (--io-only); see io_probe.h */
+    bool ioOnly;
+    /** Count hardware events around API calls (--perf); see
+     * perf_counters.h */
+    bool perf;
+    /** Chrome trace JSON file to write a timeline of the run to
+     * (--trace); empty for none.  See trace.h. */
+    std::string traceFile;
+    /** Report each worker's peak RSS, page faults, context switches,
+     * and allocations (--resources); see resource_usage.h */
+    bool resources;
+
+    ExecutionOptions() :
+        numForks{1},
+        numThreads{0},
+        affinity{Affinity::None},
+        merge{false},
+        ioOnly{false},
+        perf{false},
+        resources{false}
+        {}
+
+    ExecutionMode
+    mode() const
+    { return (this->numThreads > 0 ? ExecutionMode::Thread : ExecutionMode::Process); }
+
+    int
+    numWorkers() const
+    { return (this->numThreads > 0 ? this->numThreads : this->numForks); }
+};
+
+/**
+ * @brief
+ * Summary of one runWorkers() call
+ */
+struct ExecutionReport {
+    ExecutionMode mode;
+    /** Number of input splits that were run */
+    int numWorkers;
+    /** Wall-clock time from the first dispatch until every worker finished */
+    double seconds;
+    /** Peak resident set size in KB; in process mode, summed over the
+     * parent and every worker */
+    long peakRSSKB;
+
+    ExecutionReport() :
+        mode{ExecutionMode::Process},
+        numWorkers{0},
+        seconds{0},
+        peakRSSKB{0}
+        {}
+};
+
+/**
+ * @brief
+ * How the per-worker parts of one output are joined
+ */
+enum class MergeFormat {
+    /** Text log; every part starts with the same header line, which is
+     * kept once */
+    Log,
+    /** Bytes copied as-is (e.g., an EDB), except for the first
+     * headerBytes of every part after the first */
+    Concatenate,
+    /** EDB manifest of "id size offset" lines; offsets are rebased onto
+     * the merged EDB */
+    Manifest
+};
+
+/**
+ * @brief
+ * One output that workers write in parts: worker i writes
+ * path + "." + i, and merging produces path itself
+ */
+struct MergeOutput {
+    std::string path;
+    MergeFormat format;
+    /** Concatenate: size of the file header each part repeats */
+    size_t headerBytes;
+    /** Manifest: path of the merged EDB the offsets point into, itself
+     * written in parts */
+    std::string edb;
+
+    MergeOutput(
+        const std::string &path,
+        MergeFormat format = MergeFormat::Log,
+        size_t headerBytes = 0,
+        const std::string &edb = "") :
+        path{path},
+        format{format},
+        headerBytes{headerBytes},
+        edb{edb}
+        {}
+};
+
+/**
+ * @brief
+ * Work done by one worker: process the lines of inputFile, writing
+ * per-worker output named after worker, and return SUCCESS, FAILURE,
+ * or NOT_IMPLEMENTED.
+ */
+typedef std::function<int(const std::string &inputFile, int worker)> WorkerFunction;
+
+/** @brief This function returns the CPUs a worker is pinned to
+ *
+ * @param[in] affinity
+ * Pinning policy
+ * @param[in] worker
+ * Worker index; indices past the number of available CPUs (or NUMA
+ * nodes) wrap around
+ *
+ * @return
+ * CPU numbers, drawn from the CPUs this process may run on; empty for
+ * Affinity::None
+ */
+std::vector<int>
+workerCPUs(
+        Affinity affinity,
+        int worker);
+
+/** @brief This function pins the calling process (or, in thread mode,
+ * the calling thread) to workerCPUs(affinity, worker)
+ *
+ * @return
+ * true if pinned or affinity is Affinity::None; false otherwise
+ */
+bool
+pinWorker(
+        Affinity affinity,
+        int worker);
+
+/** @brief This function parses a command-line flag handled by the
+ * execution engine
+ *
+ * @param[in] argc
+ * Number of entries in argv
+ * @param[in] argv
+ * Command-line arguments
+ * @param[in,out] index
+ * Index of the flag in argv; on success, advanced to the last argument
+ * consumed, as a driver's own flag parsing does with ++i
+ * @param[in,out] options
+ * Updated with the parsed value
+ *
+ * @return
+ * true if argv[index] is an execution flag; false otherwise
+ */
+bool
+parseExecutionFlag(
+        int argc,
+        char *argv[],
+        int &index,
+        ExecutionOptions &options);
+
+/** @brief Usage text for the flags accepted by parseExecutionFlag() */
+std::string
+executionUsage();
+
+/** @brief This function joins the parts written by numWorkers workers
+ * into one file per output, and removes the parts
+ *
+ * @details
+ * Input splits are contiguous, so joining parts in worker order keeps
+ * records in input order.  Every part lands at a precomputed offset,
+ * so parts are copied concurrently, with copy_file_range() (or
+ * sendfile() where the filesystem does not support it) keeping the data
+ * in the kernel.  Parts are removed only once every output is complete;
+ * on failure, the parts are kept and the merged files removed.
+ *
+ * @return
+ * SUCCESS, or FAILURE if a part is missing or could not be copied
+ */
+int
+mergeWorkerOutputs(
+        const std::vector<MergeOutput> &outputs,
+        int numWorkers);
+
+/** @brief This function splits inputFile into one file per worker,
+ * runs worker on each split in processes or threads, and waits for all
+ * of them to finish
+ *
+ * @details
+ * In process mode, each worker runs in a child process that exits with
+ * the worker's return value.  In thread mode, the workers run on a
+ * ThreadPool in this process, one thread per split, so as in process
+ * mode a thread whose split finishes early stays idle; a worker that
+ * raises a signal ends the whole run.  Either way, each worker is
+ * pinned according to options.affinity before it starts.  With
+ * options.merge, outputs are merged by mergeWorkerOutputs() only if
+ * every worker succeeded.  With options.ioOnly, workers write no
+ * outputs, so nothing is merged; instead, the loads they recorded are
+ * reported by reportIOProbes().
+ * With options.perf, each worker's API call counts are reported by
+ * reportPerfCounters() unless a worker failed.  With options.traceFile,
+ * the spans recorded by the parent and every worker are written there,
+ * whether or not a worker failed.  With options.resources, each worker's
+ * resource use is reported by reportResourceUsage(), also whether or
+ * not a worker failed.
+ *
+ * @param[in] inputFile
+ * Path to input file
+ * @param[in] outputDir
+ * Directory the input splits are written to
+ * @param[in] options
+ * Execution mode and number of workers
+ * @param[in] worker
+ * Work to run on each split
+ * @param[in] outputs
+ * Outputs the workers write in parts, for --merge
+ * @param[out] report
+ * If not null, populated with timing and memory use of the run
+ *
+ * @return
+ * FAILURE if the input could not be split, any worker failed, or
+ * merging failed;
+ * otherwise NOT_IMPLEMENTED if any worker returned it; otherwise SUCCESS
+ */
+int
+runWorkers(
+        const std::string &inputFile,
+        const std::string &outputDir,
+        const ExecutionOptions &options,
+        const WorkerFunction &worker,
+        const std::vector<MergeOutput> &outputs = {},
+        ExecutionReport *report = nullptr);
+
+#endif /* EXECUTION_H_ */
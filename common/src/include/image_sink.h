@@ -0,0 +1,128 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef IMAGE_SINK_H_
+#define IMAGE_SINK_H_
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "frvt_structs.h"
+
+/**
+ * @brief
+ * On-disk encodings supported by ImageSink
+ */
+enum class ImageFormat {
+    /** Uncompressed PGM (P5) for 8-bit and PPM (P6) for 24-bit images */
+    PNM,
+    /** Lossless PNG; only available when built with zlib */
+    PNG
+};
+
+/**
+ * @brief
+ * Mapping from string to ImageFormat
+ */
+extern std::map<std::string, ImageFormat> mapStringToImageFormat;
+
+/**
+ * @brief
+ * Asynchronous image writer.
+ *
+ * @details
+ * Images handed to write() are placed on a bounded queue and encoded
+ * and written to disk by a pool of writer threads, so the caller only
+ * blocks when the queue is full.  Pixel data is shared with the caller
+ * through FRVT::Image::data, not copied.  The sink must be constructed
+ * in the process that uses it (i.e., after fork()).
+ */
+class ImageSink {
+public:
+    /**
+     * @param[in] format
+     * Encoding used for every image written through this sink
+     * @param[in] numWriters
+     * Number of writer threads draining the queue
+     * @param[in] maxQueued
+     * Maximum number of images waiting to be written before write() blocks
+     */
+    ImageSink(
+        ImageFormat format = ImageFormat::PNM,
+        unsigned int numWriters = 1,
+        size_t maxQueued = 16);
+
+    /** Drains the queue and joins the writer threads. */
+    ~ImageSink();
+
+    ImageSink(const ImageSink&) = delete;
+    ImageSink& operator=(const ImageSink&) = delete;
+
+    /** @brief Returns whether this build can encode the requested format. */
+    static bool
+    isSupported(ImageFormat format);
+
+    /**
+     * @brief Returns the file extension (including the leading '.')
+     * that will be used for an image of the given depth.
+     */
+    std::string
+    extension(uint8_t depth) const;
+
+    /**
+     * @brief Queue an image to be written to outputPath.
+     *
+     * @return
+     * false if the image is not writable (zero dimensions or an
+     * unsupported depth); true otherwise
+     */
+    bool
+    write(
+        const FRVT::Image &image,
+        const std::string &outputPath);
+
+    /**
+     * @brief Wait for all queued images to be written and stop the
+     * writer threads.  No further calls to write() may be made.
+     *
+     * @return
+     * Number of images that could not be written
+     */
+    size_t
+    close();
+
+private:
+    struct Job {
+        FRVT::Image image;
+        std::string path;
+    };
+
+    void
+    run();
+
+    bool
+    encode(const Job &job) const;
+
+    ImageFormat format;
+    size_t maxQueued;
+    std::deque<Job> queue;
+    std::mutex queueMutex;
+    std::condition_variable notEmpty, notFull;
+    std::vector<std::thread> writers;
+    bool closed;
+    size_t failures;
+};
+
+#endif /* IMAGE_SINK_H_ */
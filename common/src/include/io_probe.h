@@ -0,0 +1,114 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef IO_PROBE_H_
+#define IO_PROBE_H_
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * @brief
+ * Size and load time of every file one worker reads in --io-only mode.
+ *
+ * @details
+ * With --io-only, a driver parses its input and loads each image or
+ * template through the same functions a normal run uses, but never
+ * calls the implementation, so the resulting rate is the ceiling the
+ * storage (and image decoding) puts on a run.  Each worker records its
+ * loads into a part file next to its input split; once every worker
+ * has finished, runWorkers() summarizes the parts with
+ * reportIOProbes().
+ */
+class IOProbe {
+public:
+    /**
+     * @param[in] path
+     * Part file written by write()
+     */
+    explicit IOProbe(const std::string &path);
+
+    /**
+     * @brief Times one load of file
+     *
+     * @param[in] file
+     * File being loaded; its size is what the load counts as read
+     * @param[in] load
+     * Reads file, returning whether it succeeded.  On failure, the
+     * error is reported and SIGTERM raised, as the drivers do for an
+     * unreadable input.
+     */
+    void
+    load(
+        const std::string &file,
+        const std::function<bool()> &load);
+
+    /** @brief Writes the recorded loads to the part file */
+    bool
+    write() const;
+
+private:
+    std::string path;
+    /* Bytes and nanoseconds of each load */
+    std::vector<std::pair<uint64_t, uint64_t>> samples;
+};
+
+/** @brief Loads done for one input line in --io-only mode */
+typedef std::function<void(const std::string &line, IOProbe &probe)> LineLoader;
+
+/** @brief This function returns the part file worker writes its
+ * loads to in --io-only mode */
+std::string
+ioProbePath(
+        const std::string &outputDir,
+        int worker);
+
+/** @brief This function runs loadLine on every line of one input
+ * split in place of the driver's action, then writes the probe and
+ * removes the split as the action would
+ *
+ * @param[in] inputFile
+ * Input split
+ * @param[in] probePath
+ * Part file to write, from ioProbePath()
+ * @param[in] loadLine
+ * Loads the files one line names
+ *
+ * @return
+ * SUCCESS, or FAILURE if the split or the probe could not be opened
+ */
+int
+loadInputOnly(
+        const std::string &inputFile,
+        const std::string &probePath,
+        const LineLoader &loadLine);
+
+/** @brief This function prints the throughput and load latency
+ * percentiles of an --io-only run, and removes the part files
+ *
+ * @param[in] outputDir
+ * Directory the parts were written to
+ * @param[in] numWorkers
+ * Number of workers
+ * @param[in] seconds
+ * Wall-clock time of the run
+ *
+ * @return
+ * SUCCESS, or FAILURE if a part is missing
+ */
+int
+reportIOProbes(
+        const std::string &outputDir,
+        int numWorkers,
+        double seconds);
+
+#endif /* IO_PROBE_H_ */
@@ -0,0 +1,122 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef LRU_CACHE_H_
+#define LRU_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * @brief
+ * Least-recently-used cache bounded by a total cost (e.g., bytes).
+ *
+ * @details
+ * Each entry is inserted with a caller-supplied cost.  When the sum of
+ * costs exceeds the capacity, the least recently used entries are
+ * evicted.  An entry whose cost alone exceeds the capacity is not
+ * cached.  Not thread-safe; intended to be owned by a single worker.
+ */
+template<typename Key, typename Value>
+class LRUCache {
+public:
+    /**
+     * @param[in] capacity
+     * Maximum total cost of cached entries.  A capacity of 0 disables
+     * caching.
+     */
+    explicit LRUCache(uint64_t capacity) :
+        capacity{capacity},
+        cost{0},
+        hits{0},
+        misses{0},
+        evictions{0}
+        {}
+
+    /**
+     * @brief Look up key, marking it as most recently used.
+     *
+     * @return
+     * Pointer to the cached value, or nullptr if not present.  The
+     * pointer is valid until the next call to put().
+     */
+    Value*
+    get(const Key &key)
+    {
+        auto it = this->index.find(key);
+        if (it == this->index.end()) {
+            this->misses++;
+            return nullptr;
+        }
+        this->hits++;
+        this->entries.splice(this->entries.begin(), this->entries, it->second);
+        return &(it->second->value);
+    }
+
+    /** @brief Insert or replace key, evicting as needed. */
+    void
+    put(
+        const Key &key,
+        Value value,
+        uint64_t entryCost)
+    {
+        auto it = this->index.find(key);
+        if (it != this->index.end()) {
+            this->cost -= it->second->cost;
+            this->entries.erase(it->second);
+            this->index.erase(it);
+        }
+        if (entryCost > this->capacity)
+            return;
+
+        while (this->cost + entryCost > this->capacity && !this->entries.empty()) {
+            auto &last = this->entries.back();
+            this->cost -= last.cost;
+            this->index.erase(last.key);
+            this->entries.pop_back();
+            this->evictions++;
+        }
+        this->entries.push_front(Entry{key, std::move(value), entryCost});
+        this->index[key] = this->entries.begin();
+        this->cost += entryCost;
+    }
+
+    /** @brief Number of cached entries */
+    size_t
+    size() const { return this->entries.size(); }
+
+    /** @brief Number of lookups that found a cached entry */
+    uint64_t
+    getHits() const { return this->hits; }
+
+    /** @brief Number of lookups that did not find a cached entry */
+    uint64_t
+    getMisses() const { return this->misses; }
+
+    /** @brief Number of entries evicted to make room */
+    uint64_t
+    getEvictions() const { return this->evictions; }
+
+private:
+    struct Entry {
+        Key key;
+        Value value;
+        uint64_t cost;
+    };
+
+    uint64_t capacity, cost;
+    uint64_t hits, misses, evictions;
+    std::list<Entry> entries;
+    std::unordered_map<Key, typename std::list<Entry>::iterator> index;
+};
+
+#endif /* LRU_CACHE_H_ */
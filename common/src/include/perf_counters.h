@@ -0,0 +1,120 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef PERF_COUNTERS_H_
+#define PERF_COUNTERS_H_
+
+#include <string>
+
+#include "trace.h"
+
+/**
+ * @brief
+ * Hardware performance counters around API calls (--perf).
+ *
+ * @details
+ * When enabled, each worker thread opens one perf_event_open() group
+ * counting cycles, instructions, last-level cache misses, branch
+ * misses, and context switches for that thread, and perfCall() reads
+ * the group before and after every call it wraps.  Counts are
+ * accumulated per API function for each worker, written to a part file
+ * when the worker finishes, and printed by reportPerfCounters().
+ *
+ * Counting degrades rather than fails: events the machine or kernel
+ * does not support (e.g., hardware events in many virtual machines)
+ * are reported as "-", and if perf_event_paranoid forbids counting
+ * kernel code, only user-space counts are collected.  Threads an
+ * implementation starts itself are not counted.
+ */
+
+/** @brief This function turns counting on or off for workers started
+ * from now on; runWorkers() calls it from ExecutionOptions::perf */
+void
+enablePerfCounters(bool enabled);
+
+/** @brief Whether counting is on */
+bool
+perfCountersEnabled();
+
+/** @brief Per-thread reader of the counter group */
+class PerfScope {
+public:
+    /** Reads the counters before the call named function */
+    explicit PerfScope(const char *function);
+    /** Reads them again and adds the difference to the function's totals */
+    ~PerfScope();
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    const char *function;
+    bool counting;
+};
+
+/** @brief This function runs call, counting it under function when
+ * counting is on, and recording it as a span of that name when tracing
+ * is on (see trace.h)
+ *
+ * @param[in] function
+ * Name of the API function call invokes
+ * @param[in] call
+ * The API call
+ *
+ * @return
+ * What call returns
+ */
+template <typename Call>
+auto
+perfCall(
+        const char *function,
+        Call call) -> decltype(call())
+{
+    TraceScope trace(function);
+    if (!perfCountersEnabled())
+        return call();
+    PerfScope scope(function);
+    return call();
+}
+
+/** @brief This function opens the calling thread's counters and clears
+ * its totals before a worker starts */
+void
+startPerfCounters();
+
+/** @brief This function writes the calling thread's totals to path and
+ * closes its counters once a worker finishes
+ *
+ * @return
+ * true if written; false otherwise
+ */
+bool
+finishPerfCounters(const std::string &path);
+
+/** @brief This function returns the part file worker writes its
+ * counts to */
+std::string
+perfCountersPath(
+        const std::string &outputDir,
+        int worker);
+
+/** @brief This function prints per-call averages, IPC, and LLC misses
+ * per thousand instructions for every worker and API function, and for
+ * all workers combined, and removes the part files
+ *
+ * @return
+ * SUCCESS, or FAILURE if a part is missing
+ */
+int
+reportPerfCounters(
+        const std::string &outputDir,
+        int numWorkers);
+
+#endif /* PERF_COUNTERS_H_ */
@@ -0,0 +1,97 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef RESOURCE_USAGE_H_
+#define RESOURCE_USAGE_H_
+
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+
+/**
+ * @brief
+ * Per-worker memory, page fault, context switch, and allocation
+ * accounting (--resources).
+ *
+ * @details
+ * Each worker records how many records it was given and, on its own
+ * thread, the page faults, context switches, and heap allocations of
+ * its run, and writes them to a part file when it finishes.  In process
+ * mode, the parent replaces the thread's counts with the ones wait4()
+ * returns for the whole child, which include threads an implementation
+ * starts and the child's peak RSS; in thread mode, peak RSS is only
+ * known for the whole process.
+ *
+ * Allocations are counted only when alloc_counter.cpp is linked in or
+ * preloaded (e.g., LD_PRELOAD=benchmark/lib/libfrvt_alloc_counter.so).
+ * In thread mode, workers share one counter, so only the total is
+ * reported.
+ */
+
+/** @brief What wait4() returned for one worker's child process */
+struct ChildUsage {
+    /** Whether the child was forked and reaped; usage is only
+     * meaningful if so */
+    bool reaped;
+    struct rusage usage;
+
+    ChildUsage() :
+        reaped{false},
+        usage{}
+        {}
+};
+
+/** @brief This function records the starting counts of the calling
+ * thread and the number of records in inputFile, before a worker
+ * starts on it */
+void
+startResourceUsage(const std::string &inputFile);
+
+/** @brief This function writes the calling thread's counts since
+ * startResourceUsage() to path once a worker finishes
+ *
+ * @return
+ * true if written; false otherwise
+ */
+bool
+finishResourceUsage(const std::string &path);
+
+/** @brief This function returns the part file worker writes its
+ * counts to */
+std::string
+resourceUsagePath(
+        const std::string &outputDir,
+        int worker);
+
+/** @brief This function prints one row per worker and a total row:
+ * records, peak RSS, major and minor page faults, voluntary and
+ * involuntary context switches, and allocations per record, and
+ * removes the part files.  Workers that left no part (e.g., killed by
+ * the OOM killer) are still shown, from what wait4() returned.
+ *
+ * @param[in] outputDir
+ * Directory of the part files
+ * @param[in] numWorkers
+ * Number of workers
+ * @param[in] childUsage
+ * In process mode, what wait4() returned for each worker's child;
+ * empty in thread mode.  Workers whose child was never reaped (e.g.,
+ * fork() failed) are shown as "-".
+ * @param[in] peakRSSKB
+ * Peak RSS of the run, as in ExecutionReport
+ */
+void
+reportResourceUsage(
+        const std::string &outputDir,
+        int numWorkers,
+        const std::vector<ChildUsage> &childUsage,
+        long peakRSSKB);
+
+#endif /* RESOURCE_USAGE_H_ */
@@ -0,0 +1,96 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief
+ * Timeline of driver stages (--trace), in Chrome trace JSON.
+ *
+ * @details
+ * Each thread records spans into its own fixed-size ring buffer, so
+ * recording takes no lock and, once the buffer is full, overwrites the
+ * oldest spans rather than growing.  A forked worker flushes every
+ * buffer of its process to a fragment when it finishes; the parent
+ * then joins the fragments and its own spans into one file, with one
+ * process per worker in process mode and one thread per worker in
+ * thread mode.  Timestamps come from the system-wide monotonic clock,
+ * so spans from all processes share one timeline.
+ *
+ * Load the file in chrome://tracing or https://ui.perfetto.dev.
+ */
+
+/** @brief This function turns recording on, clearing any recorded
+ * spans; runWorkers() calls it when ExecutionOptions::traceFile is set */
+void
+enableTrace();
+
+/** @brief Whether spans are being recorded */
+bool
+traceEnabled();
+
+/**
+ * @brief
+ * Records the lifetime of the scope as one span on the calling thread.
+ * Does nothing unless recording is on.
+ */
+class TraceScope {
+public:
+    /**
+     * @param[in] name
+     * Span name; must outlive the run (e.g., a string literal)
+     */
+    explicit TraceScope(const char *name);
+    ~TraceScope();
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char *name;
+    /* Start, in nanoseconds of the monotonic clock; 0 when not recording */
+    uint64_t start;
+};
+
+/** @brief This function labels the calling thread (and, in a forked
+ * worker, its process) in the trace */
+void
+setTraceThreadName(const std::string &name);
+
+/** @brief This function writes the spans of every thread in this
+ * process to the fragment for worker, to be joined by writeTrace()
+ *
+ * @return
+ * true if written; false otherwise
+ */
+bool
+flushTraceFragment(
+        const std::string &outputDir,
+        int worker);
+
+/** @brief This function writes the Chrome trace JSON file: the spans of
+ * this process and the fragments of numWorkers forked workers, which
+ * are removed.  Missing fragments (e.g., from workers killed by a
+ * signal) are skipped.
+ *
+ * @return
+ * SUCCESS, or FAILURE if the file could not be written
+ */
+int
+writeTrace(
+        const std::string &traceFile,
+        const std::string &outputDir,
+        int numWorkers);
+
+#endif /* TRACE_H_ */
@@ -58,6 +58,25 @@ splitInputFile(
         int &numForks,
         std::vector<std::string> &fileVector);
 
+/** @brief This function writes the lines of an input file to a new
+ * file, stably sorted on one whitespace-delimited column
+ *
+ * @param[in] inputFile
+ * Path to input file
+ * @param[in] outputFile
+ * Path to the sorted file to write
+ * @param[in] keyColumn
+ * Zero-based index of the column to sort on
+ *
+ * @return
+ * EXIT_SUCCESS if successful; EXIT_FAILURE otherwise
+ */
+int
+sortInputFile(
+        const std::string &inputFile,
+        const std::string &outputFile,
+        unsigned int keyColumn);
+
 /** @brief This function reads a PPM file into a FRVT::Image data
  * structure
  *
@@ -65,7 +84,9 @@ splitInputFile(
  * Path to image file
  * @param[out] image
  * The populated FRVT::Image data structure with raw image data
- * and associated metadata
+ * and associated metadata.  If image already holds a pixel buffer of
+ * the same size that is not shared with any other Image, that buffer
+ * is reused rather than reallocated.
  *
  * @return
  * true if successful; false otherwise
@@ -99,6 +120,8 @@ enum class Action {
     Finalize_1N,
     Search_1N,
     SearchMulti_1N,
+	/* QUALITY + 1:N */
+    QualityGatedEnroll_1N,
 	/* MORPH */
     DetectNonScannedMorph,
     DetectScannedMorph,
@@ -109,6 +132,7 @@ enum class Action {
     DetectNonScannedMorphWithProbeImgAndMeta,
     DetectScannedMorphWithProbeImgAndMeta,
     DetectUnknownMorphWithProbeImgAndMeta,
+    DetectMorphMulti,
     Compare,
     Demorph,
     DemorphDifferentially,
@@ -123,7 +147,8 @@ enum class Action {
     DetectEvasionPA,
     /*AGE ESTIMATION */	
     EstimateAge,					
-    VerifyAge
+    VerifyAge,
+    EstimateAndVerifyAge
 };
 
 /**
@@ -163,6 +188,16 @@ extern std::map<Action, std::string> mapActionToString;
  */
 extern std::map<std::string, FRVT::Image::ImageDescription> mapStringToImgLabel;
 
+/** @brief This function looks up an image description label without
+ * modifying mapStringToImgLabel, so it is safe to call from concurrent
+ * workers
+ *
+ * @return
+ * The matching ImageDescription, or FaceUnknown if label is not known
+ */
+FRVT::Image::ImageDescription
+toImageDescription(const std::string &label);
+
 /**
  * @brief
  * Mapping ReturnCode to string
@@ -0,0 +1,106 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "alloc_counter.h"
+
+namespace {
+
+std::atomic<uint64_t> count{0}, bytes{0};
+
+void *
+allocate(size_t size)
+{
+    count.fetch_add(1, std::memory_order_relaxed);
+    bytes.fetch_add(size, std::memory_order_relaxed);
+    return malloc(size > 0 ? size : 1);
+}
+
+void
+resetInChild()
+{
+    count = 0;
+    bytes = 0;
+}
+
+/* Registers the fork handler on load and reports on exit */
+struct Reporter {
+    Reporter() { pthread_atfork(nullptr, nullptr, resetInChild); }
+
+    ~Reporter()
+    {
+        const char *path = getenv("FRVT_ALLOC_COUNT_FILE");
+        if (path == nullptr)
+            return;
+        FILE *file = fopen(path, "a");
+        if (file == nullptr)
+            return;
+        fprintf(file, "%d %llu %llu\n", static_cast<int>(getpid()),
+            static_cast<unsigned long long>(count.load()),
+            static_cast<unsigned long long>(bytes.load()));
+        fclose(file);
+    }
+} reporter;
+
+}
+
+uint64_t
+allocationCount()
+{
+    return count.load(std::memory_order_relaxed);
+}
+
+uint64_t
+allocatedBytes()
+{
+    return bytes.load(std::memory_order_relaxed);
+}
+
+/*
+ * Memory comes from malloc(), so the default operator delete (free())
+ * releases it; only allocation needs replacing.
+ */
+
+void *
+operator new(size_t size)
+{
+    void *p = allocate(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void *
+operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *
+operator new(
+    size_t size,
+    const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void *
+operator new[](
+    size_t size,
+    const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
@@ -0,0 +1,150 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+
+using namespace std;
+
+namespace {
+
+off_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0 ? st.st_size : -1);
+}
+
+}
+
+Checkpoint::Checkpoint(
+    const string &path,
+    const string &inputFile,
+    const vector<string> &outputs,
+    uint64_t interval) :
+    path{path},
+    inputFile{inputFile},
+    outputs{outputs},
+    interval{interval},
+    records{0},
+    complete{false},
+    failed{false}
+{
+}
+
+bool
+Checkpoint::start(
+    bool resume,
+    streamoff &offset)
+{
+    offset = 0;
+    if (!resume) {
+        remove(this->path.c_str());
+        return false;
+    }
+
+    /*
+     * Format:
+     *   inputSize <bytes>
+     *   offset <bytes>
+     *   records <count>
+     *   complete <0|1>
+     *   output <bytes>     (one line per output, in order)
+     */
+    ifstream stream(this->path);
+    string key;
+    off_t inputSize;
+    uint64_t records;
+    bool complete;
+    streamoff restored;
+    if (!(stream >> key >> inputSize >> key >> restored >> key >> records >> key >> complete))
+        return false;
+    if (inputSize != fileSize(this->inputFile)) {
+        cerr << "[ERROR] " << this->path << " was written for a different "
+                "input split; resume with the same input and number of workers."
+                << endl;
+        this->failed = true;
+        return false;
+    }
+
+    vector<off_t> sizes(this->outputs.size());
+    for (auto &size : sizes)
+        if (!(stream >> key >> size))
+            return false;
+    for (size_t i = 0; i < sizes.size(); i++)
+        if (fileSize(this->outputs[i]) < sizes[i] ||
+                truncate(this->outputs[i].c_str(), sizes[i]) != 0) {
+            cerr << "[ERROR] Cannot restore " << this->outputs[i] <<
+                    " to checkpoint " << this->path << "." << endl;
+            this->failed = true;
+            return false;
+        }
+
+    offset = restored;
+    this->records = records;
+    this->complete = complete;
+    return true;
+}
+
+void
+Checkpoint::update(
+    istream &input,
+    const vector<ostream*> &streams)
+{
+    this->records++;
+    if (this->interval > 0 && this->records % this->interval == 0)
+        this->write(input.tellg(), streams);
+}
+
+void
+Checkpoint::finish(const vector<ostream*> &streams)
+{
+    if (this->interval == 0)
+        return;
+    this->complete = true;
+    this->write(fileSize(this->inputFile), streams);
+}
+
+bool
+Checkpoint::write(
+    streamoff offset,
+    const vector<ostream*> &streams)
+{
+    /* Sizes are only meaningful once buffered output reaches the file */
+    for (auto &stream : streams)
+        stream->flush();
+
+    string temp{this->path + ".tmp"};
+    {
+        ofstream stream(temp);
+        stream << "inputSize " << fileSize(this->inputFile) << "\n"
+                << "offset " << offset << "\n"
+                << "records " << this->records << "\n"
+                << "complete " << this->complete << "\n";
+        for (const auto &output : this->outputs)
+            stream << "output " << fileSize(output) << "\n";
+        if (!stream.flush()) {
+            cerr << "[ERROR] Failed to write checkpoint " << temp << "." << endl;
+            return false;
+        }
+    }
+    if (rename(temp.c_str(), this->path.c_str()) != 0) {
+        cerr << "[ERROR] Failed to write checkpoint " << this->path << ": " <<
+                strerror(errno) << endl;
+        return false;
+    }
+    return true;
+}
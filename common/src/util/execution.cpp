@@ -0,0 +1,759 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sched.h>
+#include <set>
+#include <tuple>
+#include <sys/resource.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "execution.h"
+#include "io_probe.h"
+#include "perf_counters.h"
+#include "resource_usage.h"
+#include "trace.h"
+#include "util.h"
+
+using namespace std;
+
+std::map<ExecutionMode, std::string> mapExecutionModeToString =
+{
+    { ExecutionMode::Process, "process" },
+    { ExecutionMode::Thread, "thread" },
+};
+
+std::map<std::string, Affinity> mapStringToAffinity =
+{
+    { "none", Affinity::None },
+    { "compact", Affinity::Compact },
+    { "scatter", Affinity::Scatter },
+    { "numa", Affinity::NUMA },
+};
+
+namespace {
+
+/* A CPU this process may run on, and where it sits in the machine */
+struct CPU {
+    int id, package, core, node;
+    /* Index of this core within its package, and of this CPU among the
+     * SMT siblings of its core */
+    int coreRank, siblingRank;
+};
+
+/* Parse a sysfs list such as "0-3,8,10-11" */
+vector<int>
+parseCPUList(const string &list)
+{
+    vector<int> ids;
+    for (const auto &range : split(list, ',')) {
+        auto bounds = split(range, '-');
+        int first = atoi(bounds[0].c_str());
+        int last = (bounds.size() > 1 ? atoi(bounds[1].c_str()) : first);
+        for (int id = first; id <= last; id++)
+            ids.push_back(id);
+    }
+    return ids;
+}
+
+int
+readSysfsInt(
+    const string &path,
+    int fallback)
+{
+    ifstream stream(path);
+    int value;
+    return (stream >> value ? value : fallback);
+}
+
+/* CPUs in this process's affinity mask, with socket, core, and NUMA node
+ * from sysfs; without sysfs, every CPU is its own core on node 0 */
+vector<CPU>
+readTopology()
+{
+    vector<CPU> cpus;
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+        return cpus;
+
+    map<int, int> nodeOf;
+    ifstream online("/sys/devices/system/node/online");
+    string nodes;
+    if (std::getline(online, nodes))
+        for (const auto &node : parseCPUList(nodes)) {
+            ifstream cpulist("/sys/devices/system/node/node" +
+                to_string(node) + "/cpulist");
+            string list;
+            if (std::getline(cpulist, list))
+                for (const auto &id : parseCPUList(list))
+                    nodeOf[id] = node;
+        }
+
+    for (int id = 0; id < CPU_SETSIZE; id++) {
+        if (!CPU_ISSET(id, &allowed))
+            continue;
+        string topology = "/sys/devices/system/cpu/cpu" + to_string(id) + "/topology/";
+        CPU cpu;
+        cpu.id = id;
+        cpu.package = readSysfsInt(topology + "physical_package_id", 0);
+        cpu.core = readSysfsInt(topology + "core_id", id);
+        cpu.node = (nodeOf.count(id) ? nodeOf[id] : 0);
+        cpus.push_back(cpu);
+    }
+
+    /* Rank cores within each package and siblings within each core */
+    map<int, set<int>> packageCores;
+    for (const auto &cpu : cpus)
+        packageCores[cpu.package].insert(cpu.core);
+    map<pair<int, int>, int> siblings;
+    for (auto &cpu : cpus) {
+        const auto &cores = packageCores[cpu.package];
+        cpu.coreRank = std::distance(cores.begin(), cores.find(cpu.core));
+        cpu.siblingRank = siblings[{cpu.package, cpu.core}]++;
+    }
+    return cpus;
+}
+
+/* "0-3,8" form of a list of CPU numbers */
+string
+formatCPUList(vector<int> ids)
+{
+    std::sort(ids.begin(), ids.end());
+    string list;
+    for (size_t i = 0; i < ids.size(); i++) {
+        size_t j = i;
+        while (j + 1 < ids.size() && ids[j + 1] == ids[j] + 1)
+            j++;
+        list += (list.empty() ? "" : ",") + to_string(ids[i]) +
+            (j > i ? "-" + to_string(ids[j]) : "");
+        i = j;
+    }
+    return list;
+}
+
+bool
+pinToCPUs(const vector<int> &ids)
+{
+    if (ids.empty())
+        return true;
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    for (const auto &id : ids)
+        CPU_SET(id, &cpus);
+    /* pid 0 is the calling thread, so this also works per thread */
+    return (sched_setaffinity(0, sizeof(cpus), &cpus) == 0);
+}
+
+/* Pin worker i to its planned CPUs; failure is reported but not fatal */
+void
+pinPlanned(
+    const vector<vector<int>> &plan,
+    size_t i)
+{
+    if (!pinToCPUs(plan[i]))
+        cerr << "[ERROR] Failed to pin worker " << i << " to CPUs "
+                << formatCPUList(plan[i]) << ": " << strerror(errno) << endl;
+}
+
+/* One part of a merged output, copied to its final offset */
+struct PartCopy {
+    string from, to;
+    off_t fromOffset, toOffset;
+    size_t length;
+};
+
+off_t
+fileSize(const string &path)
+{
+    struct stat st;
+    return (stat(path.c_str(), &st) == 0 ? st.st_size : -1);
+}
+
+string
+partPath(
+    const string &path,
+    int worker)
+{
+    return path + "." + to_string(worker);
+}
+
+bool
+copyPart(const PartCopy &copy)
+{
+    int in = open(copy.from.c_str(), O_RDONLY);
+    int out = open(copy.to.c_str(), O_WRONLY);
+    off_t inOffset{copy.fromOffset}, outOffset{copy.toOffset};
+    size_t remaining{copy.length};
+    while (in >= 0 && out >= 0 && remaining > 0) {
+        auto copied = copy_file_range(in, &inOffset, out, &outOffset, remaining, 0);
+        /* sendfile() writes at the file position, so set it first */
+        if (copied < 0 && (errno == EXDEV || errno == ENOSYS ||
+                errno == EINVAL || errno == EOPNOTSUPP) &&
+                lseek(out, outOffset, SEEK_SET) == outOffset) {
+            copied = sendfile(out, in, &inOffset, remaining);
+            if (copied > 0)
+                outOffset += copied;
+        }
+        if (copied <= 0)
+            break;
+        remaining -= copied;
+    }
+    if (remaining > 0)
+        cerr << "[ERROR] Failed to copy " << copy.from << " into " << copy.to <<
+                ": " << strerror(errno) << endl;
+    if (in >= 0)
+        close(in);
+    if (out >= 0)
+        close(out);
+    return (remaining == 0);
+}
+
+/* Rewrite manifest parts with offsets into the merged EDB; the offset
+ * is the last field, after the id and template size */
+bool
+mergeManifest(
+    const MergeOutput &manifest,
+    int numWorkers)
+{
+    ofstream outputStream(manifest.path);
+    off_t base{0};
+    for (int i = 0; i < numWorkers && outputStream; i++) {
+        ifstream inputStream(partPath(manifest.path, i));
+        string line;
+        while (std::getline(inputStream, line)) {
+            auto field = line.find_last_of(' ');
+            char *end{nullptr};
+            long long offset = (field == string::npos ? -1 :
+                strtoll(line.c_str() + field + 1, &end, 10));
+            if (offset < 0 || *end != '\0') {
+                cerr << "[ERROR] Malformed manifest entry in " <<
+                        partPath(manifest.path, i) << ": " << line << endl;
+                return false;
+            }
+            outputStream.write(line.data(), field + 1);
+            outputStream << base + offset << "\n";
+        }
+        base += fileSize(partPath(manifest.edb, i));
+    }
+    if (!outputStream.flush()) {
+        cerr << "[ERROR] Failed to write " << manifest.path << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+/* Combine worker statuses so that a failure anywhere is reported */
+int
+mergeStatus(
+    int current,
+    int status)
+{
+    if (current == FAILURE || status == FAILURE)
+        return FAILURE;
+    if (current == NOT_IMPLEMENTED || status == NOT_IMPLEMENTED)
+        return NOT_IMPLEMENTED;
+    return (status == SUCCESS ? current : FAILURE);
+}
+
+int
+runProcesses(
+    const vector<string> &inputFileVector,
+    const vector<vector<int>> &plan,
+    const WorkerFunction &worker,
+    long &peakRSSKB,
+    vector<ChildUsage> &childUsage)
+{
+    int numChildren{0};
+    auto exitStatus = SUCCESS;
+    /* Worker of each child, to file what wait4() returns */
+    map<pid_t, size_t> workers;
+    childUsage.assign(inputFileVector.size(), ChildUsage());
+    for (size_t i = 0; i < inputFileVector.size(); i++) {
+        /* Fork */
+        pid_t pid = fork();
+        switch(pid) {
+        case 0: /* Child */
+            pinPlanned(plan, i);
+            exit(worker(inputFileVector[i], i));
+        case -1: /* Error */
+            cerr << "Problem forking" << endl;
+            exitStatus = FAILURE;
+            break;
+        default: /* Parent */
+            workers[pid] = i;
+            numChildren++;
+            break;
+        }
+    }
+
+    /* Parent -- wait for children.  Each child has its own copy of the
+     * implementation, so their peaks are summed. */
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    peakRSSKB = usage.ru_maxrss;
+    while (numChildren > 0) {
+        int stat_val;
+        pid_t cpid;
+
+        cpid = wait4(-1, &stat_val, 0, &usage);
+        if (cpid == -1)
+            break;
+        /* Not a worker (e.g., a process the implementation started) */
+        auto it = workers.find(cpid);
+        if (it == workers.end())
+            continue;
+        peakRSSKB += usage.ru_maxrss;
+        childUsage[it->second].reaped = true;
+        childUsage[it->second].usage = usage;
+        if (WIFEXITED(stat_val)) {
+            exitStatus = mergeStatus(exitStatus, WEXITSTATUS(stat_val));
+        } else if (WIFSIGNALED(stat_val)) {
+            cerr << "PID " << cpid << " exited due to signal " <<
+                    WTERMSIG(stat_val) << endl;
+            exitStatus = FAILURE;
+        } else {
+            cerr << "PID " << cpid << " exited with unknown status." << endl;
+            exitStatus = FAILURE;
+        }
+        numChildren--;
+    }
+    return exitStatus;
+}
+
+int
+runThreads(
+    const vector<string> &inputFileVector,
+    const vector<vector<int>> &plan,
+    const WorkerFunction &worker,
+    long &peakRSSKB)
+{
+    vector<int> status(inputFileVector.size(), SUCCESS);
+    {
+        ThreadPool pool(inputFileVector.size());
+        for (size_t i = 0; i < inputFileVector.size(); i++)
+            pool.submit([&, i] {
+                pinPlanned(plan, i);
+                status[i] = worker(inputFileVector[i], i);
+            });
+        pool.wait();
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    peakRSSKB = usage.ru_maxrss;
+
+    auto exitStatus = SUCCESS;
+    for (const auto &s : status)
+        exitStatus = mergeStatus(exitStatus, s);
+    return exitStatus;
+}
+
+}
+
+ThreadPool::ThreadPool(unsigned int numThreads) :
+    queued{0},
+    pending{0},
+    nextQueue{0},
+    stopping{false}
+{
+    numThreads = std::max(1U, numThreads);
+    for (unsigned int i = 0; i < numThreads; i++)
+        this->queues.emplace_back(new Queue());
+    for (unsigned int i = 0; i < numThreads; i++)
+        this->threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->available.notify_all();
+    for (auto &thread : this->threads)
+        thread.join();
+}
+
+void
+ThreadPool::submit(std::function<void()> task)
+{
+    size_t target;
+    {
+        lock_guard<std::mutex> lock(this->mutex);
+        target = this->nextQueue++ % this->queues.size();
+    }
+    {
+        lock_guard<std::mutex> lock(this->queues[target]->mutex);
+        this->queues[target]->tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard<std::mutex> lock(this->mutex);
+        this->queued++;
+        this->pending++;
+    }
+    this->available.notify_one();
+}
+
+void
+ThreadPool::wait()
+{
+    unique_lock<std::mutex> lock(this->mutex);
+    this->idle.wait(lock, [this] { return (this->pending == 0); });
+}
+
+bool
+ThreadPool::take(
+    size_t self,
+    std::function<void()> &task)
+{
+    /* Newest task from our own queue first, then the oldest from others */
+    for (size_t n = 0; n < this->queues.size(); n++) {
+        auto &queue = *this->queues[(self + n) % this->queues.size()];
+        lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            continue;
+        if (n == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void
+ThreadPool::run(size_t self)
+{
+    while (true) {
+        {
+            unique_lock<std::mutex> lock(this->mutex);
+            this->available.wait(lock, [this] {
+                return (this->stopping || this->queued > 0); });
+            if (this->queued == 0)
+                return;
+            /* Reserve a task; one is guaranteed to be in some queue */
+            this->queued--;
+        }
+
+        std::function<void()> task;
+        while (!this->take(self, task))
+            std::this_thread::yield();
+        task();
+
+        lock_guard<std::mutex> lock(this->mutex);
+        if (--this->pending == 0)
+            this->idle.notify_all();
+    }
+}
+
+vector<int>
+workerCPUs(
+        Affinity affinity,
+        int worker)
+{
+    static const vector<CPU> topology = readTopology();
+    vector<int> ids;
+    if (affinity == Affinity::None || topology.empty() || worker < 0)
+        return ids;
+
+    if (affinity == Affinity::NUMA) {
+        set<int> nodes;
+        for (const auto &cpu : topology)
+            nodes.insert(cpu.node);
+        auto node = *std::next(nodes.begin(), worker % nodes.size());
+        for (const auto &cpu : topology)
+            if (cpu.node == node)
+                ids.push_back(cpu.id);
+        return ids;
+    }
+
+    /* Physical cores before SMT siblings in both cases; compact then
+     * fills a package before moving on, scatter alternates packages */
+    auto order = topology;
+    std::sort(order.begin(), order.end(), [affinity](const CPU &a, const CPU &b) {
+        if (affinity == Affinity::Compact)
+            return std::make_tuple(a.siblingRank, a.package, a.coreRank, a.id) <
+                std::make_tuple(b.siblingRank, b.package, b.coreRank, b.id);
+        return std::make_tuple(a.siblingRank, a.coreRank, a.package, a.id) <
+            std::make_tuple(b.siblingRank, b.coreRank, b.package, b.id);
+    });
+    ids.push_back(order[worker % order.size()].id);
+    return ids;
+}
+
+bool
+pinWorker(
+        Affinity affinity,
+        int worker)
+{
+    return pinToCPUs(workerCPUs(affinity, worker));
+}
+
+bool
+parseExecutionFlag(
+        int argc,
+        char *argv[],
+        int &index,
+        ExecutionOptions &options)
+{
+    /* Flags without a value */
+    if (strcmp(argv[index],"--merge") == 0) {
+        options.merge = true;
+        return true;
+    }
+    if (strcmp(argv[index],"--io-only") == 0) {
+        options.ioOnly = true;
+        return true;
+    }
+    if (strcmp(argv[index],"--perf") == 0) {
+        options.perf = true;
+        return true;
+    }
+    if (strcmp(argv[index],"--resources") == 0) {
+        options.resources = true;
+        return true;
+    }
+
+    if (index + 1 >= argc)
+        return false;
+    if (strcmp(argv[index],"-t") == 0)
+        options.numForks = atoi(argv[++index]);
+    else if (strcmp(argv[index],"-n") == 0)
+        options.numThreads = atoi(argv[++index]);
+    else if (strcmp(argv[index],"--trace") == 0)
+        options.traceFile = argv[++index];
+    else if (strcmp(argv[index],"--affinity") == 0) {
+        auto it = mapStringToAffinity.find(argv[++index]);
+        if (it == mapStringToAffinity.end()) {
+            cerr << "[ERROR] Unknown affinity: " << argv[index] <<
+                    " (expected none, compact, scatter, or numa)" << endl;
+            exit(EXIT_FAILURE);
+        }
+        options.affinity = it->second;
+    } else
+        return false;
+    return true;
+}
+
+string
+executionUsage()
+{
+    return "-t numForks [-n numThreads] [--affinity compact|scatter|numa] [--merge] [--io-only] [--perf] [--resources] [--trace traceFile]";
+}
+
+int
+mergeWorkerOutputs(
+        const vector<MergeOutput> &outputs,
+        int numWorkers)
+{
+    /* Lay out every part before creating or copying anything */
+    vector<PartCopy> copies;
+    vector<pair<string, off_t>> sizes;
+    for (const auto &output : outputs) {
+        off_t size{0};
+        for (int i = 0; i < numWorkers; i++) {
+            auto part = partPath(output.path, i);
+            off_t partSize = fileSize(part);
+            if (partSize < 0 || (output.format == MergeFormat::Manifest &&
+                    fileSize(partPath(output.edb, i)) < 0)) {
+                cerr << "[ERROR] Missing worker output " << part << "." << endl;
+                return FAILURE;
+            }
+            off_t header{0};
+            if (i > 0 && output.format == MergeFormat::Log) {
+                ifstream partStream(part);
+                string line;
+                if (std::getline(partStream, line))
+                    header = std::min<off_t>(line.size() + 1, partSize);
+            } else if (i > 0 && output.format == MergeFormat::Concatenate)
+                header = std::min<off_t>(output.headerBytes, partSize);
+            if (output.format != MergeFormat::Manifest)
+                copies.push_back({part, output.path, header, size,
+                    static_cast<size_t>(partSize - header)});
+            size += partSize - header;
+        }
+        if (output.format != MergeFormat::Manifest)
+            sizes.emplace_back(output.path, size);
+    }
+
+    /* Size each merged file up front, so parts can land in any order */
+    atomic<bool> ok{true};
+    for (const auto &file : sizes) {
+        int fd = open(file.first.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || ftruncate(fd, file.second) != 0) {
+            cerr << "[ERROR] Failed to create " << file.first << ": " <<
+                    strerror(errno) << endl;
+            ok = false;
+        }
+        if (fd >= 0)
+            close(fd);
+    }
+    if (ok) {
+        ThreadPool pool(std::min<size_t>(
+            std::max(1U, std::thread::hardware_concurrency()),
+            copies.size() + outputs.size()));
+        for (const auto &copy : copies)
+            pool.submit([&ok, &copy] {
+                if (!copyPart(copy))
+                    ok = false;
+            });
+        for (const auto &output : outputs)
+            if (output.format == MergeFormat::Manifest)
+                pool.submit([&ok, &output, numWorkers] {
+                    if (!mergeManifest(output, numWorkers))
+                        ok = false;
+                });
+        pool.wait();
+    }
+    /* On failure, keep the parts and drop the partial merge */
+    if (!ok) {
+        for (const auto &output : outputs)
+            remove(output.path.c_str());
+        return FAILURE;
+    }
+
+    for (const auto &output : outputs)
+        for (int i = 0; i < numWorkers; i++)
+            if (remove(partPath(output.path, i).c_str()) != 0)
+                cerr << "Error deleting file: " << partPath(output.path, i) << endl;
+    return SUCCESS;
+}
+
+int
+runWorkers(
+        const string &inputFile,
+        const string &outputDir,
+        const ExecutionOptions &options,
+        const WorkerFunction &worker,
+        const vector<MergeOutput> &outputs,
+        ExecutionReport *report)
+{
+    if (!options.traceFile.empty()) {
+        enableTrace();
+        setTraceThreadName("driver");
+    }
+
+    /* Split input file into appropriate number of splits */
+    int numWorkers = options.numWorkers();
+    vector<string> inputFileVector;
+    int splitStatus;
+    {
+        TraceScope trace("splitInputFile");
+        splitStatus = (numWorkers < 1 ? FAILURE :
+            splitInputFile(inputFile, outputDir, numWorkers, inputFileVector));
+    }
+    if (splitStatus != SUCCESS) {
+        cerr << "[ERROR] An error occurred with processing the input file." << endl;
+        return FAILURE;
+    }
+
+    /* Decide every worker's CPUs up front, from the parent's mask */
+    vector<vector<int>> plan;
+    for (size_t i = 0; i < inputFileVector.size(); i++)
+        plan.push_back(workerCPUs(options.affinity, i));
+    if (options.affinity != Affinity::None) {
+        cerr << "[INFO] Worker CPUs:";
+        for (size_t i = 0; i < plan.size(); i++)
+            cerr << (i > 0 ? ";" : "") << " " << i << ":" << formatCPUList(plan[i]);
+        cerr << endl;
+    }
+
+    /* Each worker counts its own API calls, on its own thread */
+    enablePerfCounters(options.perf);
+    WorkerFunction counted = worker;
+    if (options.perf)
+        counted = [&worker, &outputDir](const string &inputFile, int i) -> int {
+            startPerfCounters();
+            auto status = worker(inputFile, i);
+            if (!finishPerfCounters(perfCountersPath(outputDir, i)))
+                return FAILURE;
+            return status;
+        };
+
+    /* Each worker records its own records, faults, and allocations */
+    if (options.resources)
+        counted = [counted, &outputDir](const string &inputFile, int i) -> int {
+            startResourceUsage(inputFile);
+            auto status = counted(inputFile, i);
+            if (!finishResourceUsage(resourceUsagePath(outputDir, i)))
+                return FAILURE;
+            return status;
+        };
+
+    /* A forked worker flushes its spans before exiting; in thread mode
+     * they stay in this process until writeTrace() */
+    bool forked = (options.mode() == ExecutionMode::Process);
+    if (!options.traceFile.empty())
+        counted = [counted, &outputDir, forked](const string &inputFile, int i) -> int {
+            setTraceThreadName("worker " + to_string(i));
+            int status;
+            {
+                TraceScope trace("worker");
+                status = counted(inputFile, i);
+            }
+            if (forked)
+                flushTraceFragment(outputDir, i);
+            return status;
+        };
+
+    auto start = chrono::steady_clock::now();
+    long peakRSSKB{0};
+    vector<ChildUsage> childUsage;
+    auto exitStatus = (forked ?
+        runProcesses(inputFileVector, plan, counted, peakRSSKB, childUsage) :
+        runThreads(inputFileVector, plan, counted, peakRSSKB));
+    double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+
+    if (options.resources)
+        reportResourceUsage(outputDir, inputFileVector.size(), childUsage,
+            peakRSSKB);
+
+    enablePerfCounters(false);
+    if (options.perf && exitStatus != FAILURE &&
+            reportPerfCounters(outputDir, inputFileVector.size()) != SUCCESS)
+        exitStatus = FAILURE;
+    if (report != nullptr) {
+        report->mode = options.mode();
+        report->numWorkers = inputFileVector.size();
+        report->seconds = seconds;
+        report->peakRSSKB = peakRSSKB;
+    }
+
+    if (options.ioOnly) {
+        if (exitStatus != FAILURE && reportIOProbes(outputDir,
+                inputFileVector.size(), seconds) != SUCCESS)
+            exitStatus = FAILURE;
+    } else if (options.merge && !outputs.empty() && exitStatus == SUCCESS) {
+        /* Workers that returned NOT_IMPLEMENTED removed their outputs */
+        TraceScope trace("mergeWorkerOutputs");
+        if (mergeWorkerOutputs(outputs, inputFileVector.size()) != SUCCESS)
+            exitStatus = FAILURE;
+    }
+
+    if (!options.traceFile.empty() && writeTrace(options.traceFile, outputDir,
+            forked ? inputFileVector.size() : 0) != SUCCESS)
+        exitStatus = FAILURE;
+    return exitStatus;
+}
@@ -0,0 +1,232 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef FRVT_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "image_sink.h"
+
+using namespace std;
+using namespace FRVT;
+
+std::map<std::string, ImageFormat> mapStringToImageFormat =
+{
+    { "pnm", ImageFormat::PNM },
+    { "png", ImageFormat::PNG },
+};
+
+namespace {
+
+bool
+writePNM(
+    const Image &image,
+    const string &path)
+{
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+
+    /* P5 for grayscale, P6 for RGB */
+    fprintf(fp, "%s\n", image.depth == 8 ? "P5" : "P6");
+    fprintf(fp, "%d %d\n", image.width, image.height);
+    fprintf(fp, "255\n");
+    auto written = fwrite(image.data.get(), 1, image.size(), fp);
+    return ((fclose(fp) == 0) && (written == image.size()));
+}
+
+#ifdef FRVT_HAVE_ZLIB
+void
+putUint32(
+    vector<uint8_t> &buf,
+    uint32_t value)
+{
+    buf.push_back((value >> 24) & 0xFF);
+    buf.push_back((value >> 16) & 0xFF);
+    buf.push_back((value >> 8) & 0xFF);
+    buf.push_back(value & 0xFF);
+}
+
+/* Append a length-prefixed, CRC-terminated PNG chunk to buf */
+void
+putChunk(
+    vector<uint8_t> &buf,
+    const char *type,
+    const uint8_t *data,
+    size_t length)
+{
+    putUint32(buf, length);
+    auto typeStart = buf.size();
+    buf.insert(buf.end(), type, type + 4);
+    if (length > 0)
+        buf.insert(buf.end(), data, data + length);
+    auto crc = crc32(0L, buf.data() + typeStart, length + 4);
+    putUint32(buf, crc);
+}
+
+bool
+writePNG(
+    const Image &image,
+    const string &path)
+{
+    static const uint8_t signature[] = { 137, 80, 78, 71, 13, 10, 26, 10 };
+    const size_t channels = image.depth / 8;
+    const size_t rowBytes = image.width * channels;
+
+    /* Every scanline is prefixed with filter type 0 (None) */
+    vector<uint8_t> raw((rowBytes + 1) * image.height);
+    for (size_t y = 0; y < image.height; y++) {
+        raw[y * (rowBytes + 1)] = 0;
+        memcpy(&raw[y * (rowBytes + 1) + 1],
+            image.data.get() + y * rowBytes, rowBytes);
+    }
+
+    uLongf compressedSize = compressBound(raw.size());
+    vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, raw.data(),
+            raw.size(), Z_DEFAULT_COMPRESSION) != Z_OK)
+        return false;
+
+    vector<uint8_t> ihdr;
+    putUint32(ihdr, image.width);
+    putUint32(ihdr, image.height);
+    ihdr.push_back(8);                        /* Bits per channel */
+    ihdr.push_back(channels == 1 ? 0 : 2);    /* Grayscale or RGB */
+    ihdr.push_back(0);                        /* Deflate */
+    ihdr.push_back(0);                        /* Adaptive filtering */
+    ihdr.push_back(0);                        /* No interlace */
+
+    vector<uint8_t> png(signature, signature + sizeof(signature));
+    png.reserve(compressedSize + 64);
+    putChunk(png, "IHDR", ihdr.data(), ihdr.size());
+    putChunk(png, "IDAT", compressed.data(), compressedSize);
+    putChunk(png, "IEND", nullptr, 0);
+
+    FILE *fp = fopen(path.c_str(), "wb");
+    if (fp == nullptr)
+        return false;
+    auto written = fwrite(png.data(), 1, png.size(), fp);
+    return ((fclose(fp) == 0) && (written == png.size()));
+}
+#endif /* FRVT_HAVE_ZLIB */
+
+}
+
+ImageSink::ImageSink(
+    ImageFormat format,
+    unsigned int numWriters,
+    size_t maxQueued) :
+    format{format},
+    maxQueued{maxQueued > 0 ? maxQueued : 1},
+    closed{false},
+    failures{0}
+{
+    if (numWriters == 0)
+        numWriters = 1;
+    for (unsigned int i = 0; i < numWriters; i++)
+        this->writers.emplace_back(&ImageSink::run, this);
+}
+
+ImageSink::~ImageSink()
+{
+    this->close();
+}
+
+bool
+ImageSink::isSupported(ImageFormat format)
+{
+#ifdef FRVT_HAVE_ZLIB
+    return true;
+#else
+    return (format == ImageFormat::PNM);
+#endif
+}
+
+string
+ImageSink::extension(uint8_t depth) const
+{
+    if (this->format == ImageFormat::PNG)
+        return ".png";
+    return (depth == 8 ? ".pgm" : ".ppm");
+}
+
+bool
+ImageSink::write(
+    const Image &image,
+    const string &outputPath)
+{
+    if (image.width == 0 || image.height == 0 || !image.data ||
+            (image.depth != 8 && image.depth != 24))
+        return false;
+
+    unique_lock<mutex> lock(this->queueMutex);
+    this->notFull.wait(lock, [this] {
+        return (this->queue.size() < this->maxQueued || this->closed); });
+    if (this->closed)
+        return false;
+    this->queue.push_back(Job{image, outputPath});
+    lock.unlock();
+    this->notEmpty.notify_one();
+    return true;
+}
+
+size_t
+ImageSink::close()
+{
+    {
+        lock_guard<mutex> lock(this->queueMutex);
+        this->closed = true;
+    }
+    this->notEmpty.notify_all();
+    this->notFull.notify_all();
+    for (auto &writer : this->writers)
+        if (writer.joinable())
+            writer.join();
+    this->writers.clear();
+
+    lock_guard<mutex> lock(this->queueMutex);
+    return this->failures;
+}
+
+void
+ImageSink::run()
+{
+    while (true) {
+        unique_lock<mutex> lock(this->queueMutex);
+        this->notEmpty.wait(lock, [this] {
+            return (!this->queue.empty() || this->closed); });
+        /* Drain everything that was queued before close() */
+        if (this->queue.empty())
+            return;
+        Job job = std::move(this->queue.front());
+        this->queue.pop_front();
+        lock.unlock();
+        this->notFull.notify_one();
+
+        if (!this->encode(job)) {
+            cerr << "[ERROR] Failed to write image: " << job.path << "." << endl;
+            lock_guard<mutex> failLock(this->queueMutex);
+            this->failures++;
+        }
+    }
+}
+
+bool
+ImageSink::encode(const Job &job) const
+{
+#ifdef FRVT_HAVE_ZLIB
+    if (this->format == ImageFormat::PNG)
+        return writePNG(job.image, job.path);
+#endif
+    return writePNM(job.image, job.path);
+}
@@ -0,0 +1,143 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sys/stat.h>
+
+#include "io_probe.h"
+#include "util.h"
+
+using namespace std;
+
+IOProbe::IOProbe(const string &path) :
+    path{path}
+{
+}
+
+void
+IOProbe::load(
+    const string &file,
+    const function<bool()> &load)
+{
+    auto start = chrono::steady_clock::now();
+    if (!load()) {
+        cerr << "[ERROR] Failed to load file: " << file << "." << endl;
+        raise(SIGTERM);
+    }
+    auto nanoseconds = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - start).count();
+
+    struct stat st;
+    uint64_t bytes = (stat(file.c_str(), &st) == 0 ? st.st_size : 0);
+    this->samples.emplace_back(bytes, nanoseconds);
+}
+
+bool
+IOProbe::write() const
+{
+    ofstream stream(this->path, ios::binary);
+    for (const auto &sample : this->samples) {
+        stream.write((const char*)&sample.first, sizeof(sample.first));
+        stream.write((const char*)&sample.second, sizeof(sample.second));
+    }
+    if (!stream.flush()) {
+        cerr << "[ERROR] Failed to write " << this->path << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+string
+ioProbePath(
+        const string &outputDir,
+        int worker)
+{
+    return outputDir + "/io_probe." + to_string(worker);
+}
+
+int
+loadInputOnly(
+        const string &inputFile,
+        const string &probePath,
+        const LineLoader &loadLine)
+{
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << inputFile << "." << endl;
+        return FAILURE;
+    }
+
+    IOProbe probe(probePath);
+    string line;
+    while (std::getline(inputStream, line))
+        loadLine(line, probe);
+    inputStream.close();
+
+    /* Remove the input file */
+    if( remove(inputFile.c_str()) != 0 )
+        cerr << "Error deleting file: " << inputFile << endl;
+
+    return (probe.write() ? SUCCESS : FAILURE);
+}
+
+int
+reportIOProbes(
+        const string &outputDir,
+        int numWorkers,
+        double seconds)
+{
+    uint64_t totalBytes{0};
+    vector<uint64_t> latencies;
+    for (int i = 0; i < numWorkers; i++) {
+        auto part = ioProbePath(outputDir, i);
+        ifstream stream(part, ios::binary);
+        if (!stream.is_open()) {
+            cerr << "[ERROR] Missing worker output " << part << "." << endl;
+            return FAILURE;
+        }
+        uint64_t bytes, nanoseconds;
+        while (stream.read((char*)&bytes, sizeof(bytes)) &&
+                stream.read((char*)&nanoseconds, sizeof(nanoseconds))) {
+            totalBytes += bytes;
+            latencies.push_back(nanoseconds);
+        }
+        stream.close();
+        if (remove(part.c_str()) != 0)
+            cerr << "Error deleting file: " << part << endl;
+    }
+
+    /* Nearest-rank percentile of the load latencies, in milliseconds */
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) -> double {
+        if (latencies.empty())
+            return 0;
+        auto rank = static_cast<size_t>(ceil(p / 100 * latencies.size()));
+        return latencies[std::min(std::max<size_t>(rank, 1), latencies.size()) - 1] / 1e6;
+    };
+
+    double megabytes = totalBytes / 1e6;
+    cerr << fixed << setprecision(1) << "[INFO] I/O only: " << latencies.size()
+            << " files, " << megabytes << " MB in " << setprecision(3) << seconds
+            << " s: " << setprecision(1) << (seconds > 0 ? megabytes / seconds : 0)
+            << " MB/s, " << (seconds > 0 ? latencies.size() / seconds : 0)
+            << " files/s." << endl;
+    cerr << setprecision(3) << "[INFO] Load latency (ms): p50 " << percentile(50)
+            << ", p90 " << percentile(90) << ", p99 " << percentile(99)
+            << ", p99.9 " << percentile(99.9) << ", max " << percentile(100)
+            << "." << endl;
+    cerr << defaultfloat << setprecision(6);
+    return SUCCESS;
+}
@@ -0,0 +1,392 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <map>
+#include <sstream>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+#include "perf_counters.h"
+#include "util.h"
+
+using namespace std;
+
+namespace {
+
+/* Counted events, in the order they are reported */
+struct Event {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+const Event events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    /* Generic cache-miss event, which the kernel maps to the last-level
+     * cache on common PMUs */
+    {"LLCMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branchMisses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"contextSwitches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES}
+};
+const size_t numEvents = sizeof(events) / sizeof(events[0]);
+
+std::atomic<bool> enabled{false};
+
+/* Sums over the calls to one API function; -1 marks an event that
+ * could not be counted */
+struct Totals {
+    uint64_t calls;
+    int64_t counts[numEvents];
+
+    Totals() : calls{0} { std::fill(counts, counts + numEvents, 0); }
+};
+
+/* One reading of the group */
+struct Reading {
+    uint64_t enabled, running;
+    uint64_t values[numEvents];
+};
+
+/* Counter group of one worker thread */
+class ThreadCounters {
+public:
+    ThreadCounters() : opened{false}, userOnly{false}, leader{-1} {}
+    ~ThreadCounters() { this->close(); }
+
+    void
+    start()
+    {
+        this->totals.clear();
+        if (!this->opened)
+            this->open();
+    }
+
+    bool
+    read(Reading &reading)
+    {
+        if (!this->opened)
+            this->open();
+        if (this->leader < 0)
+            return false;
+
+        /* PERF_FORMAT_GROUP: nr, time enabled, time running, values */
+        uint64_t buffer[3 + numEvents];
+        if (::read(this->leader, buffer, sizeof(buffer)) <
+                static_cast<ssize_t>((3 + this->members.size()) * sizeof(uint64_t)))
+            return false;
+        reading.enabled = buffer[1];
+        reading.running = buffer[2];
+        for (size_t i = 0; i < this->members.size(); i++)
+            reading.values[this->members[i]] = buffer[3 + i];
+        return true;
+    }
+
+    /* Reads the counters before a call */
+    bool
+    begin()
+    {
+        Reading reading;
+        if (!this->read(reading))
+            return false;
+        this->pending.push_back(reading);
+        return true;
+    }
+
+    /* Reads them after the call begun last, and adds the difference */
+    void
+    end(const char *function)
+    {
+        Reading after;
+        bool ok = this->read(after);
+        Reading before = this->pending.back();
+        this->pending.pop_back();
+        if (ok)
+            this->add(function, before, after);
+    }
+
+    bool
+    write(const string &path)
+    {
+        ofstream stream(path);
+        stream << "userOnly " << this->userOnly << "\n" << "opened";
+        for (size_t i = 0; i < numEvents; i++)
+            stream << " " << (this->opened && this->fds[i] >= 0);
+        stream << "\n";
+        for (const auto &entry : this->totals) {
+            stream << entry.first << " " << entry.second.calls;
+            for (size_t i = 0; i < numEvents; i++)
+                stream << " " << entry.second.counts[i];
+            stream << "\n";
+        }
+        if (!stream.flush()) {
+            cerr << "[ERROR] Failed to write " << path << "." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    void
+    close()
+    {
+        for (size_t i = 0; i < numEvents && this->opened; i++)
+            if (this->fds[i] >= 0)
+                ::close(this->fds[i]);
+        this->opened = false;
+        this->leader = -1;
+        this->members.clear();
+    }
+
+private:
+    void
+    add(
+        const char *function,
+        const Reading &before,
+        const Reading &after)
+    {
+        auto &totals = this->totals[function];
+        totals.calls++;
+
+        /* Scale for the time the group was multiplexed out */
+        double scale = 1.0;
+        if (after.running > before.running && after.enabled > before.enabled)
+            scale = static_cast<double>(after.enabled - before.enabled) /
+                (after.running - before.running);
+        for (size_t i = 0; i < numEvents; i++) {
+            if (this->fds[i] < 0)
+                totals.counts[i] = -1;
+            else
+                totals.counts[i] += static_cast<int64_t>(
+                    (after.values[i] - before.values[i]) * scale + 0.5);
+        }
+    }
+
+    void
+    open()
+    {
+        this->opened = true;
+        this->userOnly = false;
+        for (size_t i = 0; i < numEvents; i++) {
+            this->fds[i] = this->openEvent(events[i], this->leader);
+            /* perf_event_paranoid >= 2 only allows user-space counts */
+            if (this->fds[i] < 0 && errno == EACCES && !this->userOnly &&
+                    this->leader < 0) {
+                this->userOnly = true;
+                this->fds[i] = this->openEvent(events[i], this->leader);
+            }
+            if (this->fds[i] < 0)
+                continue;
+            if (this->leader < 0)
+                this->leader = this->fds[i];
+            this->members.push_back(i);
+        }
+
+    }
+
+    int
+    openEvent(
+        const Event &event,
+        int group)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = event.type;
+        attr.config = event.config;
+        attr.read_format = PERF_FORMAT_GROUP |
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        attr.exclude_kernel = this->userOnly;
+        attr.exclude_hv = 1;
+        /* This thread, on any CPU */
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+            group, PERF_FLAG_FD_CLOEXEC));
+    }
+
+    bool opened, userOnly;
+    int leader;
+    int fds[numEvents];
+    /* Events in the group, in the order the kernel returns them */
+    vector<size_t> members;
+    /* Readings before the calls in progress */
+    vector<Reading> pending;
+    map<string, Totals> totals;
+};
+
+ThreadCounters&
+threadCounters()
+{
+    thread_local ThreadCounters counters;
+    return counters;
+}
+
+/* Prints one row: per-call averages, IPC, and LLC misses per thousand
+ * instructions */
+void
+printRow(
+    const string &worker,
+    const string &function,
+    const Totals &totals)
+{
+    auto perCall = [&totals](size_t i) -> string {
+        if (totals.counts[i] < 0 || totals.calls == 0)
+            return "-";
+        ostringstream value;
+        value << fixed << setprecision(1) <<
+            static_cast<double>(totals.counts[i]) / totals.calls;
+        return value.str();
+    };
+    auto ratio = [](int64_t numerator, int64_t denominator, double factor) -> string {
+        if (numerator < 0 || denominator <= 0)
+            return "-";
+        ostringstream value;
+        value << fixed << setprecision(3) <<
+            factor * numerator / denominator;
+        return value.str();
+    };
+
+    cerr << worker << " " << function << " " << totals.calls;
+    for (size_t i = 0; i < numEvents; i++)
+        cerr << " " << perCall(i);
+    cerr << " " << ratio(totals.counts[1], totals.counts[0], 1) <<
+            " " << ratio(totals.counts[2], totals.counts[1], 1000) << endl;
+}
+
+}
+
+void
+enablePerfCounters(bool on)
+{
+    enabled = on;
+}
+
+bool
+perfCountersEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+PerfScope::PerfScope(const char *function) :
+    function{function},
+    counting{false}
+{
+    this->counting = threadCounters().begin();
+}
+
+PerfScope::~PerfScope()
+{
+    if (this->counting)
+        threadCounters().end(this->function);
+}
+
+void
+startPerfCounters()
+{
+    threadCounters().start();
+}
+
+bool
+finishPerfCounters(const string &path)
+{
+    auto &counters = threadCounters();
+    bool written = counters.write(path);
+    counters.close();
+    return written;
+}
+
+string
+perfCountersPath(
+        const string &outputDir,
+        int worker)
+{
+    return outputDir + "/perf_counters." + to_string(worker);
+}
+
+int
+reportPerfCounters(
+        const string &outputDir,
+        int numWorkers)
+{
+    /* Per worker and function, in worker order */
+    vector<map<string, Totals>> workers(numWorkers);
+    map<string, Totals> combined;
+    bool userOnly{false};
+    /* Whether any worker could count each event */
+    bool opened[numEvents] = {};
+    for (int w = 0; w < numWorkers; w++) {
+        auto part = perfCountersPath(outputDir, w);
+        ifstream stream(part);
+        string key;
+        bool partUserOnly;
+        if (!(stream >> key >> partUserOnly >> key)) {
+            cerr << "[ERROR] Missing worker output " << part << "." << endl;
+            return FAILURE;
+        }
+        userOnly |= partUserOnly;
+        for (size_t i = 0; i < numEvents; i++) {
+            bool partOpened{false};
+            stream >> partOpened;
+            opened[i] |= partOpened;
+        }
+
+        string function;
+        Totals totals;
+        while (stream >> function >> totals.calls) {
+            for (size_t i = 0; i < numEvents; i++)
+                stream >> totals.counts[i];
+            workers[w][function] = totals;
+
+            auto &sum = combined[function];
+            sum.calls += totals.calls;
+            for (size_t i = 0; i < numEvents; i++)
+                sum.counts[i] = (sum.counts[i] < 0 || totals.counts[i] < 0 ?
+                    -1 : sum.counts[i] + totals.counts[i]);
+        }
+        stream.close();
+        if (remove(part.c_str()) != 0)
+            cerr << "Error deleting file: " << part << endl;
+    }
+
+    if (std::none_of(opened, opened + numEvents, [](bool o) { return o; })) {
+        cerr << "[INFO] perf_event_open() failed for every event; no "
+                "performance counters were collected (see "
+                "/proc/sys/kernel/perf_event_paranoid)." << endl;
+        return SUCCESS;
+    }
+    if (!std::all_of(opened, opened + numEvents, [](bool o) { return o; })) {
+        cerr << "[INFO] Performance counters unavailable on this machine:";
+        for (size_t i = 0; i < numEvents; i++)
+            if (!opened[i])
+                cerr << " " << events[i].name;
+        cerr << "." << endl;
+    }
+
+    cerr << "[INFO] Performance counters per API call" <<
+            (userOnly ? " (user space only)" : "") << ":" << endl;
+    cerr << "worker function calls";
+    for (size_t i = 0; i < numEvents; i++)
+        cerr << " " << events[i].name;
+    cerr << " IPC LLCMissesPerKiloInstruction" << endl;
+    for (int w = 0; w < numWorkers; w++)
+        for (const auto &entry : workers[w])
+            printRow(to_string(w), entry.first, entry.second);
+    if (numWorkers > 1)
+        for (const auto &entry : combined)
+            printRow("all", entry.first, entry.second);
+    return SUCCESS;
+}
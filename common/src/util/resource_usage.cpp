@@ -0,0 +1,225 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+#include "resource_usage.h"
+#include "util.h"
+
+using namespace std;
+
+/* Defined by alloc_counter.cpp when it is linked in or preloaded (see
+ * alloc_counter.h); null otherwise */
+uint64_t allocationCount() __attribute__((weak));
+
+namespace {
+
+/* What one worker recorded; -1 marks a count that is not known */
+struct Usage {
+    int64_t records;
+    /* Allocation counter when the worker started and finished */
+    int64_t allocationsStart, allocationsEnd;
+    int64_t majorFaults, minorFaults;
+    int64_t voluntarySwitches, involuntarySwitches;
+
+    Usage() :
+        records{-1},
+        allocationsStart{-1},
+        allocationsEnd{-1},
+        majorFaults{-1},
+        minorFaults{-1},
+        voluntarySwitches{-1},
+        involuntarySwitches{-1}
+        {}
+};
+
+/* Starting counts of the worker on this thread */
+thread_local Usage started;
+
+int64_t
+allocations()
+{
+    return (allocationCount != nullptr ?
+        static_cast<int64_t>(allocationCount()) : -1);
+}
+
+string
+format(int64_t value)
+{
+    return (value < 0 ? "-" : to_string(value));
+}
+
+string
+format(
+    int64_t numerator,
+    int64_t denominator,
+    double divisor)
+{
+    if (numerator < 0 || denominator <= 0)
+        return "-";
+    ostringstream value;
+    value << fixed << setprecision(1) <<
+        static_cast<double>(numerator) / denominator / divisor;
+    return value.str();
+}
+
+}
+
+void
+startResourceUsage(const string &inputFile)
+{
+    ifstream stream(inputFile);
+    started.records = count(istreambuf_iterator<char>(stream),
+        istreambuf_iterator<char>(), '\n');
+
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    started.majorFaults = usage.ru_majflt;
+    started.minorFaults = usage.ru_minflt;
+    started.voluntarySwitches = usage.ru_nvcsw;
+    started.involuntarySwitches = usage.ru_nivcsw;
+    started.allocationsStart = allocations();
+}
+
+bool
+finishResourceUsage(const string &path)
+{
+    auto end = allocations();
+    struct rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+
+    /* records allocationsStart allocationsEnd majorFaults minorFaults
+     * voluntarySwitches involuntarySwitches */
+    ofstream stream(path);
+    stream << started.records << " " << started.allocationsStart << " " <<
+            end << " " << usage.ru_majflt - started.majorFaults << " " <<
+            usage.ru_minflt - started.minorFaults << " " <<
+            usage.ru_nvcsw - started.voluntarySwitches << " " <<
+            usage.ru_nivcsw - started.involuntarySwitches << endl;
+    if (!stream.flush()) {
+        cerr << "[ERROR] Failed to write " << path << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+string
+resourceUsagePath(
+        const string &outputDir,
+        int worker)
+{
+    return outputDir + "/resource_usage." + to_string(worker);
+}
+
+void
+reportResourceUsage(
+        const string &outputDir,
+        int numWorkers,
+        const vector<ChildUsage> &childUsage,
+        long peakRSSKB)
+{
+    bool forked = !childUsage.empty();
+    vector<Usage> workers(numWorkers);
+    for (int i = 0; i < numWorkers; i++) {
+        auto part = resourceUsagePath(outputDir, i);
+        ifstream stream(part);
+        auto &worker = workers[i];
+        if (stream >> worker.records >> worker.allocationsStart >>
+                worker.allocationsEnd >> worker.majorFaults >>
+                worker.minorFaults >> worker.voluntarySwitches >>
+                worker.involuntarySwitches) {
+            stream.close();
+            if (remove(part.c_str()) != 0)
+                cerr << "Error deleting file: " << part << endl;
+        } else
+            worker = Usage();
+
+        /* The whole child, including threads the implementation started */
+        if (forked) {
+            const auto &child = childUsage[i];
+            worker.majorFaults = (child.reaped ? child.usage.ru_majflt : -1);
+            worker.minorFaults = (child.reaped ? child.usage.ru_minflt : -1);
+            worker.voluntarySwitches = (child.reaped ? child.usage.ru_nvcsw : -1);
+            worker.involuntarySwitches = (child.reaped ? child.usage.ru_nivcsw : -1);
+        }
+    }
+
+    /* Sums over workers; -1 once any worker's count is unknown */
+    auto sum = [&workers](int64_t Usage::*field) -> int64_t {
+        int64_t total{0};
+        for (const auto &worker : workers) {
+            if (worker.*field < 0)
+                return -1;
+            total += worker.*field;
+        }
+        return total;
+    };
+
+    /* Workers of one process share the counter, so only the span from
+     * the first start to the last finish is meaningful */
+    int64_t totalAllocations{-1};
+    if (forked) {
+        totalAllocations = 0;
+        for (const auto &worker : workers) {
+            if (worker.allocationsStart < 0 || worker.allocationsEnd < 0) {
+                totalAllocations = -1;
+                break;
+            }
+            totalAllocations += worker.allocationsEnd - worker.allocationsStart;
+        }
+    } else if (std::all_of(workers.begin(), workers.end(), [](const Usage &w)
+            { return w.allocationsStart >= 0 && w.allocationsEnd >= 0; })) {
+        auto first = std::min_element(workers.begin(), workers.end(),
+            [](const Usage &a, const Usage &b)
+            { return a.allocationsStart < b.allocationsStart; });
+        auto last = std::max_element(workers.begin(), workers.end(),
+            [](const Usage &a, const Usage &b)
+            { return a.allocationsEnd < b.allocationsEnd; });
+        totalAllocations = last->allocationsEnd - first->allocationsStart;
+    }
+
+    if (allocationCount == nullptr)
+        cerr << "[INFO] Allocations are not counted; preload "
+                "libfrvt_alloc_counter.so (built in benchmark/lib) to "
+                "count them." << endl;
+    cerr << "[INFO] Resource usage per worker (" << (forked ?
+            "per process" : "per thread; peak RSS for the whole process") <<
+            "):" << endl;
+    cerr << "worker records peakRSSMB majorFaults minorFaults "
+            "voluntaryContextSwitches involuntaryContextSwitches "
+            "allocationsPerRecord" << endl;
+    for (int i = 0; i < numWorkers; i++) {
+        const auto &worker = workers[i];
+        cerr << i << " " << format(worker.records) << " " <<
+                (forked && childUsage[i].reaped ?
+                    format(childUsage[i].usage.ru_maxrss, 1, 1024) : "-") <<
+                " " << format(worker.majorFaults) << " " <<
+                format(worker.minorFaults) << " " <<
+                format(worker.voluntarySwitches) << " " <<
+                format(worker.involuntarySwitches) << " " <<
+                (forked ? format(worker.allocationsEnd < 0 ||
+                    worker.allocationsStart < 0 ? -1 :
+                    worker.allocationsEnd - worker.allocationsStart,
+                    worker.records, 1) : "-") << endl;
+    }
+    cerr << "all " << format(sum(&Usage::records)) << " " <<
+            format(peakRSSKB, 1, 1024) << " " <<
+            format(sum(&Usage::majorFaults)) << " " <<
+            format(sum(&Usage::minorFaults)) << " " <<
+            format(sum(&Usage::voluntarySwitches)) << " " <<
+            format(sum(&Usage::involuntarySwitches)) << " " <<
+            format(totalAllocations, sum(&Usage::records), 1) << endl;
+}
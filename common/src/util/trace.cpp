@@ -0,0 +1,266 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <sstream>
+#include <unistd.h>
+#include <vector>
+
+#include "trace.h"
+#include "util.h"
+
+using namespace std;
+
+namespace {
+
+/* Spans kept per thread; older ones are overwritten */
+const size_t bufferCapacity{1 << 16};
+
+struct Span {
+    const char *name;
+    uint64_t start, duration;
+};
+
+/* Spans of one thread, or of one worker when a pool thread runs
+ * several in turn.  Only the owning thread records into it. */
+struct ThreadBuffer {
+    /* Track in the trace; unique within the process */
+    uint64_t tid;
+    string name;
+    vector<Span> spans;
+    /* Spans recorded, including overwritten ones */
+    uint64_t recorded;
+
+    explicit ThreadBuffer(uint64_t tid) :
+        tid{tid},
+        recorded{0}
+    { this->spans.reserve(bufferCapacity); }
+
+    void
+    add(const Span &span)
+    {
+        if (this->spans.size() < bufferCapacity)
+            this->spans.push_back(span);
+        else
+            this->spans[this->recorded % bufferCapacity] = span;
+        this->recorded++;
+    }
+};
+
+std::atomic<bool> enabled{false};
+/* Clock value at enableTrace(), inherited by forked workers */
+uint64_t base{0};
+
+/* Every thread's buffer, so one flush covers the whole process.  The
+ * mutex is only taken when a thread records its first span. */
+mutex registryMutex;
+vector<shared_ptr<ThreadBuffer>> registry;
+uint64_t nextTid{1};
+
+uint64_t
+now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+shared_ptr<ThreadBuffer>
+registerBuffer()
+{
+    lock_guard<mutex> lock(registryMutex);
+    registry.push_back(make_shared<ThreadBuffer>(nextTid++));
+    return registry.back();
+}
+
+shared_ptr<ThreadBuffer>&
+threadBuffer()
+{
+    thread_local shared_ptr<ThreadBuffer> buffer;
+    if (!buffer)
+        buffer = registerBuffer();
+    return buffer;
+}
+
+/* A forked worker starts with only the forking thread, whose buffer
+ * still holds the parent's spans */
+void
+lockRegistry() { registryMutex.lock(); }
+
+void
+unlockRegistry() { registryMutex.unlock(); }
+
+void
+resetInChild()
+{
+    registryMutex.unlock();
+    if (!enabled)
+        return;
+    registry.clear();
+    threadBuffer() = registerBuffer();
+}
+
+struct ForkHandlers {
+    ForkHandlers() { pthread_atfork(lockRegistry, unlockRegistry, resetInChild); }
+} forkHandlers;
+
+/* Writes "name" metadata and every span of this process, one JSON
+ * event per line; returns the number of spans overwritten */
+uint64_t
+writeSpans(
+    ostream &stream,
+    const string &processName)
+{
+    pid_t pid = getpid();
+    stream << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid <<
+            ",\"args\":{\"name\":\"" << processName << "\"}}\n";
+
+    lock_guard<mutex> lock(registryMutex);
+    uint64_t dropped{0};
+    stream << fixed << setprecision(3);
+    for (const auto &buffer : registry) {
+        if (!buffer->name.empty())
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid <<
+                    ",\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"" <<
+                    buffer->name << "\"}}\n";
+        for (const auto &span : buffer->spans)
+            stream << "{\"name\":\"" << span.name << "\",\"ph\":\"X\",\"pid\":" <<
+                    pid << ",\"tid\":" << buffer->tid << ",\"ts\":" <<
+                    (span.start - base) / 1e3 << ",\"dur\":" <<
+                    span.duration / 1e3 << "}\n";
+        dropped += buffer->recorded - buffer->spans.size();
+    }
+    return dropped;
+}
+
+string
+fragmentPath(
+    const string &outputDir,
+    int worker)
+{
+    return outputDir + "/trace." + to_string(worker);
+}
+
+}
+
+void
+enableTrace()
+{
+    lock_guard<mutex> lock(registryMutex);
+    for (auto &buffer : registry) {
+        buffer->spans.clear();
+        buffer->recorded = 0;
+    }
+    base = now();
+    enabled = true;
+}
+
+bool
+traceEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+TraceScope::TraceScope(const char *name) :
+    name{name},
+    start{traceEnabled() ? now() : 0}
+{
+}
+
+TraceScope::~TraceScope()
+{
+    if (this->start == 0)
+        return;
+    auto end = now();
+    threadBuffer()->add({this->name, this->start, end - this->start});
+}
+
+void
+setTraceThreadName(const string &name)
+{
+    if (!traceEnabled())
+        return;
+    /* A pool thread starting its next worker gets a new track */
+    auto &buffer = threadBuffer();
+    if (!buffer->name.empty() && buffer->name != name && buffer->recorded > 0)
+        buffer = registerBuffer();
+    buffer->name = name;
+}
+
+bool
+flushTraceFragment(
+        const string &outputDir,
+        int worker)
+{
+    /* First line: spans overwritten; then one event per line */
+    ostringstream spans;
+    auto dropped = writeSpans(spans, "worker " + to_string(worker));
+    ofstream stream(fragmentPath(outputDir, worker));
+    stream << dropped << "\n" << spans.str();
+    if (!stream.flush()) {
+        cerr << "[ERROR] Failed to write " << fragmentPath(outputDir, worker) << "." << endl;
+        return false;
+    }
+    return true;
+}
+
+int
+writeTrace(
+        const string &traceFile,
+        const string &outputDir,
+        int numWorkers)
+{
+    ostringstream events;
+    auto dropped = writeSpans(events, "driver");
+    for (int i = 0; i < numWorkers; i++) {
+        auto part = fragmentPath(outputDir, i);
+        ifstream stream(part);
+        uint64_t partDropped;
+        if (!(stream >> partDropped)) {
+            cerr << "[INFO] No trace from worker " << i << "." << endl;
+            continue;
+        }
+        dropped += partDropped;
+        stream.ignore(1);
+        events << stream.rdbuf();
+        stream.close();
+        if (remove(part.c_str()) != 0)
+            cerr << "Error deleting file: " << part << endl;
+    }
+
+    /* Join the event lines into one JSON array */
+    ofstream stream(traceFile);
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    istringstream lines(events.str());
+    string line;
+    bool first{true};
+    while (std::getline(lines, line)) {
+        if (line.empty())
+            continue;
+        stream << (first ? "" : ",\n") << line;
+        first = false;
+    }
+    stream << "\n]}\n";
+    if (!stream.flush()) {
+        cerr << "[ERROR] Failed to write trace " << traceFile << "." << endl;
+        return FAILURE;
+    }
+    if (dropped > 0)
+        cerr << "[INFO] Trace buffers overflowed; the oldest " << dropped <<
+                " spans were dropped." << endl;
+    return SUCCESS;
+}
@@ -12,6 +12,7 @@
 #include <limits>
 #include <fstream>
 
+#include "trace.h"
 #include "util.h"
 
 using namespace std;
@@ -29,6 +30,8 @@ readImage(
     const string &file,
     Image &image)
 {
+    TraceScope trace("readImage");
+
     /* Open PPM file. */
     ifstream input(file, ios::binary);
     if (!input.is_open()) {
@@ -36,6 +39,9 @@ readImage(
         return false;
     }
 
+    /* Remember the current buffer size so it can be reused below */
+    auto previousSize = image.size();
+
     /* Read in magic number. */
     string magicNumber;
     input >> magicNumber;
@@ -60,8 +66,12 @@ readImage(
     /* Skip line break. */
     input.ignore(numeric_limits<streamsize>::max(), '\n');
 
-    uint8_t *data = new uint8_t[image.size()];
-    image.data.reset(data, std::default_delete<uint8_t[]>());
+    /* Reuse the existing pixel buffer if nothing else references it and
+     * it is the right size; otherwise allocate a new one */
+    if (!image.data || image.data.use_count() != 1 || previousSize != image.size()) {
+        uint8_t *data = new uint8_t[image.size()];
+        image.data.reset(data, std::default_delete<uint8_t[]>());
+    }
 
     /* Read in raw pixel data. */
     input.read((char*)image.data.get(), image.size());
@@ -129,6 +139,41 @@ splitInputFile(
     return SUCCESS;
 }
 
+int
+sortInputFile(
+    const string &inputFile,
+    const string &outputFile,
+    unsigned int keyColumn)
+{
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << inputFile << "." << endl;
+        return FAILURE;
+    }
+
+    vector<pair<string, string>> lines;
+    string line;
+    while (getline(inputStream, line)) {
+        auto tokens = split(line, ' ');
+        string key = (keyColumn < tokens.size()) ? tokens[keyColumn] : "";
+        lines.emplace_back(key, line);
+    }
+
+    stable_sort(lines.begin(), lines.end(),
+        [](const pair<string, string> &a, const pair<string, string> &b) {
+            return (a.first < b.first); });
+
+    ofstream outputStream(outputFile);
+    if (!outputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << outputFile << "." << endl;
+        return FAILURE;
+    }
+    for (const auto &l : lines)
+        outputStream << l.second << '\n';
+
+    return (outputStream.good() ? SUCCESS : FAILURE);
+}
+
 vector<string>
 split(
         const string &str,
@@ -187,6 +232,7 @@ std::map<std::string, Action> mapStringToAction =
     { "finalize_1N", Action::Finalize_1N },
     { "search_1N", Action::Search_1N },
     { "searchMulti_1N", Action::SearchMulti_1N },
+    { "qualityGatedEnroll_1N", Action::QualityGatedEnroll_1N },
     /* MORPH */
     { "detectNonScannedMorph", Action::DetectNonScannedMorph },
     { "detectScannedMorph", Action::DetectScannedMorph },
@@ -197,6 +243,7 @@ std::map<std::string, Action> mapStringToAction =
     { "detectNonScannedMorphWithProbeImgAndMeta", Action::DetectNonScannedMorphWithProbeImgAndMeta },
     { "detectScannedMorphWithProbeImgAndMeta", Action::DetectScannedMorphWithProbeImgAndMeta },
     { "detectUnknownMorphWithProbeImgAndMeta", Action::DetectUnknownMorphWithProbeImgAndMeta },
+    { "detectMorphMulti", Action::DetectMorphMulti },
     { "compare", Action::Compare },
     { "demorph", Action::Demorph },
     { "demorphDifferentially", Action::DemorphDifferentially },
@@ -212,6 +259,7 @@ std::map<std::string, Action> mapStringToAction =
     /* AGE ESTIMATION */
     { "estimateAge", Action::EstimateAge },
     { "verifyAge", Action::VerifyAge },
+    { "estimateAndVerifyAge", Action::EstimateAndVerifyAge },
 };
 
 std::map<Action, std::string> mapActionToString =
@@ -225,6 +273,7 @@ std::map<Action, std::string> mapActionToString =
     { Action::Finalize_1N, "finalize_1N" },
     { Action::Search_1N, "search_1N" },
     { Action::SearchMulti_1N, "searchMulti_1N" },
+    { Action::QualityGatedEnroll_1N, "qualityGatedEnroll_1N" },
     /* MORPH */
     { Action::DetectNonScannedMorph, "detectNonScannedMorph" },
     { Action::DetectScannedMorph, "detectScannedMorph" },
@@ -235,6 +284,7 @@ std::map<Action, std::string> mapActionToString =
     { Action::DetectNonScannedMorphWithProbeImgAndMeta, "detectNonScannedMorphWithProbeImgAndMeta" },
     { Action::DetectScannedMorphWithProbeImgAndMeta, "detectScannedMorphWithProbeImgAndMeta" },
     { Action::DetectUnknownMorphWithProbeImgAndMeta, "detectUnknownMorphWithProbeImgAndMeta" },
+    { Action::DetectMorphMulti, "detectMorphMulti" },
     { Action::Compare, "compare" },
     { Action::Demorph, "demorph" },
     { Action::DemorphDifferentially, "demorphDifferentially" },
@@ -250,6 +300,7 @@ std::map<Action, std::string> mapActionToString =
     /* AGE ESTIMATION */
     { Action::EstimateAge, "estimateAge" },
     { Action::VerifyAge, "verifyAge" },
+    { Action::EstimateAndVerifyAge, "estimateAndVerifyAge" },
 };
 
 std::map<std::string, FRVT::Image::ImageDescription> mapStringToImgLabel =
@@ -264,6 +315,14 @@ std::map<std::string, FRVT::Image::ImageDescription> mapStringToImgLabel =
     { "iriswild", FRVT::Image::ImageDescription::IrisWild },
 };
 
+FRVT::Image::ImageDescription
+toImageDescription(const string &label)
+{
+    auto it = mapStringToImgLabel.find(label);
+    return (it == mapStringToImgLabel.end() ?
+        FRVT::Image::ImageDescription::FaceUnknown : it->second);
+}
+
 std::map<FRVT::ReturnCode, std::string> mapRetCodeToString =
 {
     { FRVT::ReturnCode::Success, "Success" },
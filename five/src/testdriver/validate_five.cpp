@@ -16,9 +16,14 @@
 #include <csignal>
 #include <sstream>
 #include <iomanip>
+#include <limits>
 #include <unordered_set>
 
+#include "execution.h"
 #include "frte_five.h"
+#include "io_probe.h"
+#include "perf_counters.h"
+#include "trace.h"
 #include "util.h"
 
 using namespace std;
@@ -47,11 +52,30 @@ std::map<std::string, FIVE::Media::Label> mapFiveStringToMediaLabel =
     { "video", FIVE::Media::Label::Video },
 };
 
+/* Non-inserting lookups, safe to call from concurrent workers */
+FIVE::Image::ImageDescription
+toFiveImageDescription(const std::string &label)
+{
+    auto it = mapFiveStringToImgLabel.find(label);
+    return (it == mapFiveStringToImgLabel.end() ?
+        FIVE::Image::ImageDescription::Unknown : it->second);
+}
+
+FIVE::Media::Label
+toFiveMediaLabel(const std::string &label)
+{
+    auto it = mapFiveStringToMediaLabel.find(label);
+    return (it == mapFiveStringToMediaLabel.end() ?
+        FIVE::Media::Label::Image : it->second);
+}
+
 bool
 readFiveImage(
     const std::string &file,
     FIVE::Image &image)
 {
+    TraceScope trace("readImage");
+
     /* Open PPM file. */
     ifstream input(file, ios::binary);
     if (!input.is_open()) {
@@ -149,7 +173,7 @@ enroll(shared_ptr<Interface> &implPtr,
             auto mediaEntry = split(tokens[i], ' ');
             FIVE::Media media;
             /* Either image or video */
-            media.type = mapFiveStringToMediaLabel[mediaEntry[0]];
+            media.type = toFiveMediaLabel(mediaEntry[0]);
             if (media.type == FIVE::Media::Label::Image)
                 media.fps = 0;
             else if (media.type == FIVE::Media::Label::Video)
@@ -166,7 +190,7 @@ enroll(shared_ptr<Interface> &implPtr,
                     std::cerr << "[ERROR] Failed to load image file: " << imagePath << "." << std::endl;
                     raise(SIGTERM);
                 }
-                image.description = mapFiveStringToImgLabel[desc];
+                image.description = toFiveImageDescription(desc);
                 media.data.push_back(image);
             }
             imageNames.push_back(names);
@@ -175,7 +199,7 @@ enroll(shared_ptr<Interface> &implPtr,
         std::vector<uint8_t> templ;
         std::vector< std::vector<FIVE::BoundingBox> > boundingBoxes;
 
-        ret = implPtr->createEnrollmentTemplate(mediaVector, templ, boundingBoxes);
+        ret = perfCall("createEnrollmentTemplate", [&] { return implPtr->createEnrollmentTemplate(mediaVector, templ, boundingBoxes); });
         /* If function is not implemented, raise error */
         if (ret.code == ReturnCode::NotImplemented) {
             std::cerr << "[ERROR] createEnrollmentTemplate() must be implemented!" << std::endl;
@@ -183,12 +207,15 @@ enroll(shared_ptr<Interface> &implPtr,
         }
 
         /* Write to edb and manifest */
-        manifestStream << id << " "
-                << templ.size() << " "
-                << edbStream.tellp() << std::endl;
-        edbStream.write(
-                (char*)templ.data(),
-                templ.size());
+        {
+            TraceScope trace("writeEnrollment");
+            manifestStream << id << " "
+                    << templ.size() << " "
+                    << edbStream.tellp() << std::endl;
+            edbStream.write(
+                    (char*)templ.data(),
+                    templ.size());
+        }
 
         /* If function returns non-successful return code or no bounding boxes 
          * are returned, fill the std::vector with default values */
@@ -318,10 +345,10 @@ searchAndLog(
 
     /* If a valid search template was generated */
     if (templGenRet.code == ReturnCode::Success) {
-        ret = implPtr->search(
+        ret = perfCall("search", [&] { return implPtr->search(
                 templ,
                 candListLength,
-                candidateList);
+                candidateList); });
         if (ret.code != ReturnCode::Success) {
             /* Populate candidate list with null entries */
             candidateList.resize(candListLength, Candidate(false, "NA", -1.0));
@@ -336,6 +363,7 @@ searchAndLog(
         checkCandidateList(id, candidateList, candListLength);
 
     /* Write to candidate list file */
+    TraceScope trace("writeCandidates");
     int i{0};
     for (const auto& candidate : candidateList)
         candListStream << id << " " << i++ << " "
@@ -387,7 +415,7 @@ search(shared_ptr<Interface> &implPtr,
         auto mediaEntry = split(tokens[1], ' ');
         FIVE::Media media;
         /* Either image or video */
-        media.type = mapFiveStringToMediaLabel[mediaEntry[0]];
+        media.type = toFiveMediaLabel(mediaEntry[0]);
         if (media.type == FIVE::Media::Label::Image)
             media.fps = 0;
         else if (media.type == FIVE::Media::Label::Video)
@@ -404,14 +432,14 @@ search(shared_ptr<Interface> &implPtr,
                 std::cerr << "[ERROR] Failed to load image file: " << imagePath << "." << std::endl;
                 raise(SIGTERM);
             }
-            image.description = mapFiveStringToImgLabel[desc];
+            image.description = toFiveImageDescription(desc);
             media.data.push_back(image);
         }
 
         std::vector< std::vector<uint8_t> > templs;
         std::vector< std::vector<FIVE::BoundingBox> > boundingBoxes;
 
-        ret = implPtr->createSearchTemplate(media, templs, boundingBoxes);
+        ret = perfCall("createSearchTemplate", [&] { return implPtr->createSearchTemplate(media, templs, boundingBoxes); });
             
         if (ret.code == ReturnCode::NotImplemented) {
             std::cerr << "[ERROR] createSearchTemplate() must be implemented!" << std::endl;
@@ -438,10 +466,28 @@ search(shared_ptr<Interface> &implPtr,
     return SUCCESS;
 }
 
+/* --io-only: load the stills and frames of one input line as enroll and
+ * search do, without calling the implementation */
+void
+loadOnly(
+    const std::string &line,
+    IOProbe &probe)
+{
+    auto tokens = split(line, '|');
+    FIVE::Image image;
+    for (unsigned int i = 1; i < tokens.size(); i++) {
+        auto mediaEntry = split(tokens[i], ' ');
+        for (unsigned int j = 0; j < mediaEntry.size()/2; j++) {
+            std::string imagePath = mediaEntry[(j*2)+1];
+            probe.load(imagePath, [&] { return readFiveImage(imagePath, image); });
+        }
+    }
+}
+
 void usage(const std::string &executable)
 {
     std::cerr << "Usage: " << executable << " enroll_1N|finalize_1N|search_1N -c configDir -e enrollDir "
-            "-o outputDir -h outputStem -i inputFile -t numForks" << std::endl;
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() << std::endl;
     exit(EXIT_FAILURE);
 }
 
@@ -518,7 +564,7 @@ main(int argc, char* argv[])
     	outputDir{"output"},
     	outputFileStem{"stem"},
     	inputFile;
-    int numForks = 1;
+    ExecutionOptions execution;
 
     for (int i = 0; i < argc - requiredArgs; i++) {
         if (strcmp(argv[requiredArgs+i],"-c") == 0)
@@ -531,9 +577,7 @@ main(int argc, char* argv[])
             outputFileStem = argv[requiredArgs+(++i)];
         else if (strcmp(argv[requiredArgs+i],"-i") == 0)
             inputFile = argv[requiredArgs+(++i)];
-        else if (strcmp(argv[requiredArgs+i],"-t") == 0)
-            numForks = atoi(argv[requiredArgs+(++i)]);
-        else {
+        else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
             std::cerr << "Unrecognized flag: " << argv[requiredArgs+i] << std::endl;;
             usage(argv[0]);
         }
@@ -550,71 +594,54 @@ main(int argc, char* argv[])
             usage(argv[0]);
     }
 
-    auto implPtr = Interface::getImplementation();
+    if (execution.ioOnly && action == Action::Finalize_1N) {
+        std::cerr << "[ERROR] --io-only applies to actions that read an input file." << std::endl;
+        usage(argv[0]);
+    }
+
+    /* --io-only never calls the implementation */
+    shared_ptr<Interface> implPtr;
+    if (!execution.ioOnly)
+        implPtr = Interface::getImplementation();
     if (action == Action::Enroll_1N || action == Action::Search_1N) {
         /* Initialization */
-        if (initialize(implPtr, configDir, enrollDir, action) != EXIT_SUCCESS)
+        if (!execution.ioOnly &&
+                initialize(implPtr, configDir, enrollDir, action) != EXIT_SUCCESS)
             return EXIT_FAILURE;
 
-        /* Split input file into appropriate number of splits */
-        std::vector<std::string> inputFileVector;
-        if (splitInputFile(inputFile, outputDir, numForks, inputFileVector) != EXIT_SUCCESS) {
-            std::cerr << "[ERROR] An error occurred with processing the input file." << std::endl;
-            return EXIT_FAILURE;
-        }
-
-        bool parent = false;
-        int i = 0;
-        for (auto &inputFile : inputFileVector) {
-            /* Fork */
-            switch(fork()) {
-            case 0: /* Child */
-                if (action == Action::Enroll_1N)
-                    return enroll(
-                            implPtr,
-                            configDir,
-                            inputFile,
-                            outputDir + "/" + outputFileStem + "." + mapActionToString[action] + "." + std::to_string(i),
-                            outputDir + "/edb." + std::to_string(i),
-                            outputDir + "/manifest." + std::to_string(i));
-                else if (action == Action::Search_1N) 
-                    return search(
-                            implPtr,
-                            configDir,
-                            enrollDir,
-                            inputFile,
-                            outputDir + "/" + outputFileStem + "." + mapActionToString[action] + "." + std::to_string(i),
-                            action);
-            case -1: /* Error */
-                std::cerr << "[ERROR] Problem forking" << std::endl;
-                break;
-            default: /* Parent */
-                parent = true;
-                break;
-            }
-            i++;
-        }
-
-        /* Parent -- wait for children */
-        if (parent) {
-            while (numForks > 0) {
-                int stat_val;
-                pid_t cpid;
-
-                cpid = wait(&stat_val);
-                if (WIFEXITED(stat_val)) { exitStatus = WEXITSTATUS(stat_val); }
-                else if (WIFSIGNALED(stat_val)) {
-                    std::cerr << "PID " << cpid << " exited due to signal " <<
-                    WTERMSIG(stat_val) << std::endl;
-                    exitStatus = FAILURE;
-                } else {
-                    std::cerr << "PID " << cpid << " exited with unknown status." << std::endl;
-                    exitStatus = FAILURE;
-                }
-
-                numForks--;
-            }
+        /* Run the requested action on one input split; map lookups
+         * are done up front since workers may be threads */
+        auto actionName = mapActionToString[action];
+        auto runAction = [&](const std::string &inputFile, int i) -> int {
+            if (execution.ioOnly)
+                return loadInputOnly(inputFile, ioProbePath(outputDir, i), loadOnly);
+            else if (action == Action::Enroll_1N)
+                return enroll(
+                        implPtr,
+                        configDir,
+                        inputFile,
+                        outputDir + "/" + outputFileStem + "." + actionName + "." + std::to_string(i),
+                        outputDir + "/edb." + std::to_string(i),
+                        outputDir + "/manifest." + std::to_string(i));
+            return search(
+                    implPtr,
+                    configDir,
+                    enrollDir,
+                    inputFile,
+                    outputDir + "/" + outputFileStem + "." + actionName + "." + std::to_string(i),
+                    action);
+        };
+
+        /* Enrollment also writes EDB and manifest parts, which merge into
+         * the edb and manifest that finalize_1N reads */
+        std::vector<MergeOutput> outputs{
+            MergeOutput(outputDir + "/" + outputFileStem + "." + actionName)};
+        if (action == Action::Enroll_1N) {
+            outputs.emplace_back(outputDir + "/edb", MergeFormat::Concatenate);
+            outputs.emplace_back(outputDir + "/manifest", MergeFormat::Manifest, 0,
+                outputDir + "/edb");
         }
+        exitStatus = runWorkers(inputFile, outputDir, execution, runAction, outputs);
     } else if (action == Action::Finalize_1N) {
         return finalize(implPtr, outputDir, enrollDir, configDir);
     } 
@@ -222,6 +222,157 @@ public:
         bool &isMorph,
         double &score) = 0;
 
+    /**
+     * @brief This function is the batched form of detectMorph().  It takes
+     * a batch of input images that share the same label and outputs a
+     * decision, score, and return status for each one.  Batches are
+     * typically 8-64 images, which lets CPU inference engines amortize
+     * per-call overhead.
+     *
+     * The default implementation calls the single-image detectMorph() for
+     * each image in the batch.  Implementations that can process batches
+     * natively should override this function.
+     *
+     * @param[in] suspectedMorphs
+     * Input images
+     * @param[in] label
+     * Label indicating the type of imagery for all images in the batch.
+     * @param[out] statuses
+     * One return status per input image, in the same order
+     * @param[out] isMorph
+     * One decision per input image, in the same order
+     * @param[out] scores
+     * One score per input image, in the same order, with the same
+     * semantics as detectMorph()
+     *
+     * @return
+     * ReturnCode::Success if the batch was processed (per-image failures
+     * are reported in statuses); an error code if the batch as a whole
+     * could not be processed
+     */
+    virtual FRVT::ReturnStatus
+    detectMorphBatch(
+        const std::vector<FRVT::Image> &suspectedMorphs,
+        const FRVT_MORPH::ImageLabel &label,
+        std::vector<FRVT::ReturnStatus> &statuses,
+        std::vector<bool> &isMorph,
+        std::vector<double> &scores)
+    {
+        statuses.resize(suspectedMorphs.size());
+        isMorph.assign(suspectedMorphs.size(), false);
+        scores.assign(suspectedMorphs.size(), -1.0);
+        for (size_t i = 0; i < suspectedMorphs.size(); i++) {
+            bool decision{false};
+            double score{-1.0};
+            statuses[i] = this->detectMorph(suspectedMorphs[i], label,
+                decision, score);
+            isMorph[i] = decision;
+            scores[i] = score;
+        }
+        return FRVT::ReturnStatus(FRVT::ReturnCode::Success);
+    }
+
+    /**
+     * @brief This function is the batched form of
+     * detectMorphDifferentially() without subject metadata.  The i-th
+     * suspected morph is evaluated against the i-th probe face.
+     *
+     * The default implementation calls the single-pair
+     * detectMorphDifferentially() for each pair in the batch.
+     *
+     * @param[in] suspectedMorphs
+     * Images in question of being a morph (or not)
+     * @param[in] label
+     * Label indicating the type of imagery for all suspected morphs in
+     * the batch.
+     * @param[in] probeFaces
+     * Images of the subjects known not to be morphs; same size as
+     * suspectedMorphs
+     * @param[out] statuses
+     * One return status per pair, in the same order
+     * @param[out] isMorph
+     * One decision per pair, in the same order
+     * @param[out] scores
+     * One score per pair, in the same order
+     */
+    virtual FRVT::ReturnStatus
+    detectMorphDifferentiallyBatch(
+        const std::vector<FRVT::Image> &suspectedMorphs,
+        const FRVT_MORPH::ImageLabel &label,
+        const std::vector<FRVT::Image> &probeFaces,
+        std::vector<FRVT::ReturnStatus> &statuses,
+        std::vector<bool> &isMorph,
+        std::vector<double> &scores)
+    {
+        if (suspectedMorphs.size() != probeFaces.size())
+            return FRVT::ReturnStatus(FRVT::ReturnCode::NumDataError);
+        statuses.resize(suspectedMorphs.size());
+        isMorph.assign(suspectedMorphs.size(), false);
+        scores.assign(suspectedMorphs.size(), -1.0);
+        for (size_t i = 0; i < suspectedMorphs.size(); i++) {
+            bool decision{false};
+            double score{-1.0};
+            statuses[i] = this->detectMorphDifferentially(suspectedMorphs[i],
+                label, probeFaces[i], decision, score);
+            isMorph[i] = decision;
+            scores[i] = score;
+        }
+        return FRVT::ReturnStatus(FRVT::ReturnCode::Success);
+    }
+
+    /**
+     * @brief This function is the batched form of
+     * detectMorphDifferentially() with subject metadata.  The i-th
+     * suspected morph is evaluated against the i-th probe face and the
+     * i-th subject metadata.
+     *
+     * The default implementation calls the single-pair
+     * detectMorphDifferentially() for each pair in the batch.
+     *
+     * @param[in] suspectedMorphs
+     * Images in question of being a morph (or not)
+     * @param[in] label
+     * Label indicating the type of imagery for all suspected morphs in
+     * the batch.
+     * @param[in] probeFaces
+     * Images of the subjects known not to be morphs; same size as
+     * suspectedMorphs
+     * @param[in] subjectMetadata
+     * Information about each subject; same size as suspectedMorphs
+     * @param[out] statuses
+     * One return status per pair, in the same order
+     * @param[out] isMorph
+     * One decision per pair, in the same order
+     * @param[out] scores
+     * One score per pair, in the same order
+     */
+    virtual FRVT::ReturnStatus
+    detectMorphDifferentiallyBatch(
+        const std::vector<FRVT::Image> &suspectedMorphs,
+        const FRVT_MORPH::ImageLabel &label,
+        const std::vector<FRVT::Image> &probeFaces,
+        const std::vector<FRVT_MORPH::SubjectMetadata> &subjectMetadata,
+        std::vector<FRVT::ReturnStatus> &statuses,
+        std::vector<bool> &isMorph,
+        std::vector<double> &scores)
+    {
+        if (suspectedMorphs.size() != probeFaces.size() ||
+                suspectedMorphs.size() != subjectMetadata.size())
+            return FRVT::ReturnStatus(FRVT::ReturnCode::NumDataError);
+        statuses.resize(suspectedMorphs.size());
+        isMorph.assign(suspectedMorphs.size(), false);
+        scores.assign(suspectedMorphs.size(), -1.0);
+        for (size_t i = 0; i < suspectedMorphs.size(); i++) {
+            bool decision{false};
+            double score{-1.0};
+            statuses[i] = this->detectMorphDifferentially(suspectedMorphs[i],
+                label, probeFaces[i], subjectMetadata[i], decision, score);
+            isMorph[i] = decision;
+            scores[i] = score;
+        }
+        return FRVT::ReturnStatus(FRVT::ReturnCode::Success);
+    }
+
     /**
      * @brief This function compares two images and outputs a
      * similarity score. In the event the algorithm cannot perform the comparison
@@ -246,6 +397,56 @@ public:
         const FRVT::Image &verifImage,
         double &similarity) = 0;
 
+    /**
+     * @brief This function extracts a feature representation from a single
+     * image for use with compareFeatures().  The test harness caches the
+     * output keyed by image, so an image that appears in many comparisons
+     * is only processed once.
+     *
+     * This function is optional.  If it is not implemented, the algorithm shall
+     * return ReturnCode::NotImplemented, and the test harness will call
+     * compareImages() for every pair instead.  An implementation that
+     * provides this function must also provide compareFeatures().
+     *
+     * @param[in] image
+     * Input face image
+     * @param[out] features
+     * Implementation-defined feature representation of the face in the image
+     */
+    virtual FRVT::ReturnStatus
+    extractFeatures(
+        const FRVT::Image &image,
+        std::vector<uint8_t> &features)
+    {
+        return FRVT::ReturnStatus(FRVT::ReturnCode::NotImplemented);
+    }
+
+    /**
+     * @brief This function compares the features of one enrollment image
+     * against the features of one or more verification images, all produced
+     * by extractFeatures(), and outputs one similarity score per verification
+     * image.  Scores follow the same semantics as compareImages().
+     *
+     * If this function is not implemented, the algorithm shall return
+     * ReturnCode::NotImplemented.
+     *
+     * @param[in] enrollFeatures
+     * Features of the enrollment image
+     * @param[in] verifFeatures
+     * Features of each verification image
+     * @param[out] similarities
+     * One similarity score per entry of verifFeatures, in the same order,
+     * on the range [0,DBL_MAX].  -1 indicates a failed comparison.
+     */
+    virtual FRVT::ReturnStatus
+    compareFeatures(
+        const std::vector<uint8_t> &enrollFeatures,
+        const std::vector<std::vector<uint8_t>> &verifFeatures,
+        std::vector<double> &similarities)
+    {
+        return FRVT::ReturnStatus(FRVT::ReturnCode::NotImplemented);
+    }
+
 
     /**
      * @brief This function takes an input image and outputs two images.  
@@ -364,7 +565,7 @@ extern uint16_t API_MINOR_VERSION;
 /** API major version number. */
 uint16_t API_MAJOR_VERSION{5};
 /** API minor version number. */
-uint16_t API_MINOR_VERSION{0};
+uint16_t API_MINOR_VERSION{2};
 #endif /* NIST_EXTERN_API_VERSION */
 }
 
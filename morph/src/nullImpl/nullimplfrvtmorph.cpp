@@ -90,6 +90,25 @@ NullImplFRVTMorph::compareImages(
     return ReturnStatus(ReturnCode::Success);
 }
 
+ReturnStatus
+NullImplFRVTMorph::extractFeatures(
+    const FRVT::Image &image,
+    std::vector<uint8_t> &features)
+{
+    features.assign(featureVectorSize, 0);
+    return ReturnStatus(ReturnCode::Success);
+}
+
+ReturnStatus
+NullImplFRVTMorph::compareFeatures(
+    const std::vector<uint8_t> &enrollFeatures,
+    const std::vector<std::vector<uint8_t>> &verifFeatures,
+    std::vector<double> &similarities)
+{
+    similarities.assign(verifFeatures.size(), 0.88);
+    return ReturnStatus(ReturnCode::Success);
+}
+
 ReturnStatus
 NullImplFRVTMorph::demorph(
     const FRVT::Image &suspectedMorph,
@@ -58,6 +58,17 @@ public:
         const FRVT::Image &verifImage,
         double &similarity) override;
 
+    FRVT::ReturnStatus
+    extractFeatures(
+        const FRVT::Image &image,
+        std::vector<uint8_t> &features) override;
+
+    FRVT::ReturnStatus
+    compareFeatures(
+        const std::vector<uint8_t> &enrollFeatures,
+        const std::vector<std::vector<uint8_t>> &verifFeatures,
+        std::vector<double> &similarities) override;
+
     FRVT::ReturnStatus
     demorph(
         const FRVT::Image &suspectedMorph,
@@ -79,6 +90,7 @@ public:
 
 private:
     std::string configDir;
+    static const int featureVectorSize{4};
     // Some other members
 };
 }
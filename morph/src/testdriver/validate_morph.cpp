@@ -11,11 +11,20 @@
 #include <iostream>
 #include <cstring>
 #include <iterator>
+#include <chrono>
+#include <thread>
+#include <sys/resource.h>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <csignal>
+#include <stdexcept>
 
+#include "execution.h"
 #include "frvt_morph.h"
+#include "image_sink.h"
+#include "io_probe.h"
+#include "lru_cache.h"
+#include "perf_counters.h"
 #include "util.h"
 
 using namespace std;
@@ -35,23 +44,55 @@ std::map<Action, FRVT_MORPH::ImageLabel> mapActionToMorphLabel =
     { Action::DetectUnknownMorphWithProbeImgAndMeta, FRVT_MORPH::ImageLabel::Unknown }
 };
 
+std::map<std::string, FRVT_MORPH::SubjectMetadata::Sex> mapStringToSexLabel =
+{
+    { "UNKNOWN", FRVT_MORPH::SubjectMetadata::Sex::Unknown },
+    { "FEMALE", FRVT_MORPH::SubjectMetadata::Sex::Female },
+    { "MALE", FRVT_MORPH::SubjectMetadata::Sex::Male },
+};
+
+/* Read-only lookup (safe to call from worker threads); unrecognized
+ * strings map to Unknown */
+FRVT_MORPH::SubjectMetadata::Sex
+toSexLabel(const string &sex)
+{
+    auto it = mapStringToSexLabel.find(sex);
+    return (it == mapStringToSexLabel.end() ?
+            FRVT_MORPH::SubjectMetadata::Sex::Unknown : it->second);
+}
+
+/* Whether a detection action takes a probe image */
+bool
+usesProbeImage(Action action)
+{
+    return (action == Action::DetectNonScannedMorphWithProbeImg ||
+            action == Action::DetectScannedMorphWithProbeImg ||
+            action == Action::DetectUnknownMorphWithProbeImg ||
+            action == Action::DetectNonScannedMorphWithProbeImgAndMeta ||
+            action == Action::DetectScannedMorphWithProbeImgAndMeta ||
+            action == Action::DetectUnknownMorphWithProbeImgAndMeta);
+}
+
+/* Whether a detection action takes subject metadata */
+bool
+usesMetadata(Action action)
+{
+    return (action == Action::DetectNonScannedMorphWithProbeImgAndMeta ||
+            action == Action::DetectScannedMorphWithProbeImgAndMeta ||
+            action == Action::DetectUnknownMorphWithProbeImgAndMeta);
+}
+
 void
-writeImagePPM(
+writeImage(
+    ImageSink &imageSink,
     const FRVT::Image &image,
     const std::string &outputStem)
 {
-    if (image.width == 0 || image.height == 0) {
+    if (!imageSink.write(image, outputStem)) {
         cerr << "Failed to write invalid image: " << outputStem << ".  " 
-            << "Invalid image dimensions." << endl;
+            << "Invalid image dimensions or depth." << endl;
         raise(SIGTERM);        
     }
-
-    FILE *fp = fopen((outputStem).c_str(), "wb");
-    fprintf(fp, "P6\n");
-    fprintf(fp, "%d %d\n", image.width, image.height);
-    fprintf(fp, "255\n");
-    fwrite(image.data.get(), 1, image.size(), fp);
-    fclose(fp);
 }
 
 int
@@ -60,7 +101,9 @@ detectMorph(
         const string &inputFile,
         const string &outputLog,
         Action action,
-        const string &outputDir)
+        const string &outputDir,
+        ImageFormat imageFormat,
+        unsigned int numWriters)
 {
     /* Read input file */
     ifstream inputStream(inputFile);
@@ -95,14 +138,11 @@ detectMorph(
     } else if (action == Action::DemorphDifferentially) {
         logStream << "image probeImage outputSubject isMorph score returnCode" << endl;
     }
-    
 
-    std::map<std::string, FRVT_MORPH::SubjectMetadata::Sex> mapStringToSexLabel =
-    {
-        { "UNKNOWN", FRVT_MORPH::SubjectMetadata::Sex::Unknown },
-        { "FEMALE", FRVT_MORPH::SubjectMetadata::Sex::Female },
-        { "MALE", FRVT_MORPH::SubjectMetadata::Sex::Male },
-    };
+    /* Demorphed images are encoded and written off the main loop */
+    std::unique_ptr<ImageSink> imageSink;
+    if (action == Action::Demorph || action == Action::DemorphDifferentially)
+        imageSink.reset(new ImageSink(imageFormat, numWriters));
 
     while (std::getline(inputStream, line)) {
         Image image, probeImage;
@@ -118,7 +158,7 @@ detectMorph(
         if (action == Action::DetectNonScannedMorph ||
                 action == Action::DetectScannedMorph ||
                 action == Action::DetectUnknownMorph) {
-            ret = implPtr->detectMorph(image, mapActionToMorphLabel[action], isMorph, score);
+            ret = perfCall("detectMorph", [&] { return implPtr->detectMorph(image, mapActionToMorphLabel.at(action), isMorph, score); });
         } else if (action == Action::DetectNonScannedMorphWithProbeImg ||
                 action == Action::DetectScannedMorphWithProbeImg ||
                 action == Action::DetectUnknownMorphWithProbeImg) {
@@ -126,7 +166,7 @@ detectMorph(
                 cerr << "Failed to load image file(s): " << imgs[1] << "." << endl;
                 raise(SIGTERM);
             }
-            ret = implPtr->detectMorphDifferentially(image, mapActionToMorphLabel[action], probeImage, isMorph, score);
+            ret = perfCall("detectMorphDifferentially", [&] { return implPtr->detectMorphDifferentially(image, mapActionToMorphLabel.at(action), probeImage, isMorph, score); });
         } else if (action == Action::DetectNonScannedMorphWithProbeImgAndMeta ||
                 action == Action::DetectScannedMorphWithProbeImgAndMeta ||
                 action == Action::DetectUnknownMorphWithProbeImgAndMeta) {
@@ -134,16 +174,16 @@ detectMorph(
                 cerr << "Failed to load image file(s): " << imgs[1] << "." << endl;
                 raise(SIGTERM);
             }
-            FRVT_MORPH::SubjectMetadata meta(mapStringToSexLabel[imgs[2]], std::stoi(imgs[3]), std::stoi(imgs[4])); 
-            ret = implPtr->detectMorphDifferentially(image, mapActionToMorphLabel[action], probeImage, meta, isMorph, score);
+            FRVT_MORPH::SubjectMetadata meta(toSexLabel(imgs[2]), std::stoi(imgs[3]), std::stoi(imgs[4])); 
+            ret = perfCall("detectMorphDifferentially", [&] { return implPtr->detectMorphDifferentially(image, mapActionToMorphLabel.at(action), probeImage, meta, isMorph, score); });
         } else if (action == Action::Demorph) {
-            ret = implPtr->demorph(image, outputSubject1, outputSubject2, isMorph, score); 
+            ret = perfCall("demorph", [&] { return implPtr->demorph(image, outputSubject1, outputSubject2, isMorph, score); }); 
         } else if (action == Action::DemorphDifferentially) {
             if (!readImage(imgs[1], probeImage)) {
                 cerr << "Failed to load image file(s): " << imgs[1] << "." << endl;
                 raise(SIGTERM);
             }
-            ret = implPtr->demorphDifferentially(image, probeImage, outputSubject1, isMorph, score);
+            ret = perfCall("demorphDifferentially", [&] { return implPtr->demorphDifferentially(image, probeImage, outputSubject1, isMorph, score); });
         }
 
         /* If function is not implemented, clean up and exit */
@@ -163,16 +203,16 @@ detectMorph(
 
         if (action == Action::Demorph) {
             auto stem = split(split(imgs[0], '/').back(), '.').front();
-            std::string subj1 = stem + "_outputSubject1.ppm";
-            std::string subj2 = stem + "_outputSubject2.ppm";
-            writeImagePPM(outputSubject1, outputDir + "/" + subj1);
-            writeImagePPM(outputSubject2, outputDir + "/" + subj2);
+            std::string subj1 = stem + "_outputSubject1" + imageSink->extension(outputSubject1.depth);
+            std::string subj2 = stem + "_outputSubject2" + imageSink->extension(outputSubject2.depth);
+            writeImage(*imageSink, outputSubject1, outputDir + "/" + subj1);
+            writeImage(*imageSink, outputSubject2, outputDir + "/" + subj2);
 
             logStream << subj1 << " " << subj2 << " ";
         } else if (action == Action::DemorphDifferentially) {
             auto stem = split(split(imgs[0], '/').back(), '.').front();
-            std::string subj1 = stem + "_outputSubject.ppm";
-            writeImagePPM(outputSubject1, outputDir + "/" + subj1);
+            std::string subj1 = stem + "_outputSubject" + imageSink->extension(outputSubject1.depth);
+            writeImage(*imageSink, outputSubject1, outputDir + "/" + subj1);
             logStream << imgs[1] << " " << subj1 << " ";
         }
         
@@ -183,6 +223,307 @@ detectMorph(
     }
     inputStream.close();
 
+    /* Wait for outstanding image writes */
+    size_t writeFailures = 0;
+    if (imageSink)
+        writeFailures = imageSink->close();
+
+    /* Remove the input file */
+    if( remove(inputFile.c_str()) != 0 )
+        cerr << "Error deleting file: " << inputFile << endl;
+
+    if (ret.code == ReturnCode::NotImplemented) {
+        /* Remove the output file */
+        logStream.close();
+        if( remove(outputLog.c_str()) != 0 )
+            cerr << "Error deleting file: " << outputLog << endl;
+        return NOT_IMPLEMENTED;
+    }
+    if (writeFailures > 0) {
+        cerr << "Failed to write " << writeFailures << " output image(s)." << endl;
+        return FAILURE;
+    }
+    return SUCCESS;
+}
+
+/* Run several detection variants against each input line, loading the
+ * images once, and write one combined log with a column group per variant.
+ * Variants a line has no probe image or metadata columns for are logged
+ * as NA, so the default of every variant works on single-image input. */
+int
+detectMorphMulti(
+        std::shared_ptr<Interface> &implPtr,
+        const string &inputFile,
+        const string &outputLog,
+        const vector<Action> &variants)
+{
+    /* Read input file */
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "Failed to open stream for " << inputFile << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* Open output log for writing */
+    ofstream logStream(outputLog);
+    if (!logStream.is_open()) {
+        cerr << "Failed to open stream for " << outputLog << "." << endl;
+        raise(SIGTERM);
+    }
+
+    bool needProbe{false}, needMeta{false};
+    for (const auto &variant : variants) {
+        needProbe |= usesProbeImage(variant);
+        needMeta |= usesMetadata(variant);
+    }
+
+    /* header */
+    logStream << "image";
+    if (needProbe)
+        logStream << " probeImage";
+    for (const auto &variant : variants) {
+        auto name = mapActionToString.at(variant);
+        logStream << " " << name << ".isMorph "
+                << name << ".score "
+                << name << ".returnCode";
+    }
+    logStream << endl;
+
+    /* Variants that returned NotImplemented are not called again */
+    vector<bool> implemented(variants.size(), true);
+    /* Lines without the columns some variant needs */
+    unsigned int shortLines{0};
+
+    string line;
+    while (std::getline(inputStream, line)) {
+        Image image, probeImage;
+        auto imgs = split(line, ' ');
+        if (imgs.empty()) {
+            cerr << "Empty line in " << inputFile << "." << endl;
+            raise(SIGTERM);
+        }
+        if (!readImage(imgs[0], image)) {
+            cerr << "Failed to load image file: " << imgs[0] << "." << endl;
+            raise(SIGTERM);
+        }
+
+        /* image [probeImage [sex age height]] */
+        bool hasProbe = (needProbe && imgs.size() >= 2);
+        bool hasMeta = (needMeta && imgs.size() >= 5);
+        if ((needProbe && !hasProbe) || (needMeta && !hasMeta))
+            shortLines++;
+        if (hasProbe && !readImage(imgs[1], probeImage)) {
+            cerr << "Failed to load image file(s): " << imgs[1] << "." << endl;
+            raise(SIGTERM);
+        }
+        FRVT_MORPH::SubjectMetadata meta;
+        if (hasMeta) {
+            try {
+                meta = FRVT_MORPH::SubjectMetadata(toSexLabel(imgs[2]),
+                        std::stoi(imgs[3]), std::stoi(imgs[4]));
+            } catch (const std::logic_error&) {
+                cerr << "Invalid age or height on line: " << line << "." << endl;
+                raise(SIGTERM);
+            }
+        }
+
+        logStream << imgs[0];
+        if (needProbe)
+            logStream << " " << (hasProbe ? imgs[1] : "NA");
+        for (size_t v = 0; v < variants.size(); v++) {
+            if ((usesProbeImage(variants[v]) && !hasProbe) ||
+                    (usesMetadata(variants[v]) && !hasMeta)) {
+                logStream << " NA NA NA";
+                continue;
+            }
+
+            ReturnStatus ret(ReturnCode::NotImplemented);
+            bool isMorph = false;
+            double score = -1.0;
+            auto label = mapActionToMorphLabel.at(variants[v]);
+            if (implemented[v]) {
+                if (usesMetadata(variants[v]))
+                    ret = perfCall("detectMorphDifferentially", [&] { return implPtr->detectMorphDifferentially(image, label, probeImage, meta, isMorph, score); });
+                else if (usesProbeImage(variants[v]))
+                    ret = perfCall("detectMorphDifferentially", [&] { return implPtr->detectMorphDifferentially(image, label, probeImage, isMorph, score); });
+                else
+                    ret = perfCall("detectMorph", [&] { return implPtr->detectMorph(image, label, isMorph, score); });
+                implemented[v] = (ret.code != ReturnCode::NotImplemented);
+            }
+
+            if (ret.code == ReturnCode::NotImplemented)
+                logStream << " NA NA ";
+            else
+                logStream << " " << isMorph << " " << score << " ";
+            logStream << static_cast<std::underlying_type<ReturnCode>::type>(ret.code);
+        }
+        logStream << endl;
+    }
+    inputStream.close();
+
+    if (shortLines > 0)
+        cerr << shortLines << " line(s) of " << inputFile << " had no probe "
+                "image or metadata; variants needing them were logged as NA."
+                << endl;
+
+    /* Remove the input file */
+    if( remove(inputFile.c_str()) != 0 )
+        cerr << "Error deleting file: " << inputFile << endl;
+
+    return SUCCESS;
+}
+
+/* Batch of detection inputs accumulated from the input file */
+typedef struct DetectBatch {
+    std::vector<std::vector<std::string>> tokens;
+    std::vector<FRVT::Image> images, probeImages;
+    std::vector<FRVT_MORPH::SubjectMetadata> metadata;
+
+    size_t
+    size() const { return tokens.size(); }
+
+    void
+    clear()
+    {
+        tokens.clear();
+        images.clear();
+        probeImages.clear();
+        metadata.clear();
+    }
+} DetectBatch;
+
+/* Call the batched detection entry point for the action and log one
+ * line per input.  Returns NotImplemented if any input was refused as
+ * not implemented, and Success otherwise. */
+ReturnStatus
+detectBatch(
+        std::shared_ptr<Interface> &implPtr,
+        Action action,
+        const DetectBatch &batch,
+        ofstream &logStream,
+        double &apiSeconds)
+{
+    vector<ReturnStatus> statuses;
+    vector<bool> isMorph;
+    vector<double> scores;
+    auto label = mapActionToMorphLabel.at(action);
+
+    auto start = chrono::steady_clock::now();
+    ReturnStatus ret;
+    if (usesMetadata(action))
+        ret = perfCall("detectMorphDifferentiallyBatch", [&] { return implPtr->detectMorphDifferentiallyBatch(batch.images, label,
+                batch.probeImages, batch.metadata, statuses, isMorph, scores); });
+    else if (usesProbeImage(action))
+        ret = perfCall("detectMorphDifferentiallyBatch", [&] { return implPtr->detectMorphDifferentiallyBatch(batch.images, label,
+                batch.probeImages, statuses, isMorph, scores); });
+    else
+        ret = perfCall("detectMorphBatch", [&] { return implPtr->detectMorphBatch(batch.images, label, statuses, isMorph, scores); });
+    apiSeconds += chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+
+    /* A failure of the batch as a whole applies to every input */
+    if (ret.code != ReturnCode::Success || statuses.size() != batch.size()) {
+        if (ret.code == ReturnCode::Success)
+            ret = ReturnStatus(ReturnCode::UnknownError);
+        statuses.assign(batch.size(), ret);
+        isMorph.assign(batch.size(), false);
+        scores.assign(batch.size(), -1.0);
+    }
+
+    for (const auto &status : statuses)
+        if (status.code == ReturnCode::NotImplemented)
+            return status;
+
+    for (size_t i = 0; i < batch.size(); i++) {
+        logStream << batch.tokens[i][0] << " ";
+        if (usesProbeImage(action))
+            logStream << batch.tokens[i][1] << " ";
+        logStream << isMorph[i] << " "
+                << scores[i] << " "
+                << static_cast<std::underlying_type<ReturnCode>::type>(statuses[i].code)
+                << endl;
+    }
+    return ReturnStatus(ReturnCode::Success);
+}
+
+int
+detectMorphBatched(
+        std::shared_ptr<Interface> &implPtr,
+        const string &inputFile,
+        const string &outputLog,
+        Action action,
+        unsigned int batchSize)
+{
+    /* Read input file */
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "Failed to open stream for " << inputFile << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* Open output log for writing */
+    ofstream logStream(outputLog);
+    if (!logStream.is_open()) {
+        cerr << "Failed to open stream for " << outputLog << "." << endl;
+        raise(SIGTERM);
+    }
+
+    if (usesProbeImage(action))
+        logStream << "image probeImage isMorph score returnCode" << endl;
+    else
+        logStream << "image isMorph score returnCode" << endl;
+
+    auto start = chrono::steady_clock::now();
+    double apiSeconds{0.0};
+    uint64_t numImages{0};
+
+    string line;
+    ReturnStatus ret(ReturnCode::Success);
+    DetectBatch batch;
+    while (ret.code != ReturnCode::NotImplemented) {
+        bool haveLine = static_cast<bool>(std::getline(inputStream, line));
+        if (haveLine) {
+            auto imgs = split(line, ' ');
+            Image image, probeImage;
+            if (!readImage(imgs[0], image)) {
+                cerr << "Failed to load image file: " << imgs[0] << "." << endl;
+                raise(SIGTERM);
+            }
+            if (usesProbeImage(action)) {
+                if (!readImage(imgs[1], probeImage)) {
+                    cerr << "Failed to load image file(s): " << imgs[1] << "." << endl;
+                    raise(SIGTERM);
+                }
+                batch.probeImages.push_back(probeImage);
+            }
+            if (usesMetadata(action))
+                batch.metadata.emplace_back(toSexLabel(imgs[2]),
+                        std::stoi(imgs[3]), std::stoi(imgs[4]));
+            batch.images.push_back(image);
+            batch.tokens.push_back(std::move(imgs));
+        }
+
+        /* Dispatch full batches, and whatever is left at end of input */
+        if (batch.size() == batchSize || (!haveLine && batch.size() > 0)) {
+            ret = detectBatch(implPtr, action, batch, logStream, apiSeconds);
+            numImages += batch.size();
+            batch.clear();
+        }
+        if (!haveLine)
+            break;
+    }
+    inputStream.close();
+
+    double totalSeconds = chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+    if (ret.code != ReturnCode::NotImplemented && numImages > 0)
+        cerr << "[INFO] " << outputLog << ": " << numImages
+                << " images, batch size " << batchSize << ": "
+                << (apiSeconds > 0 ? numImages / apiSeconds : 0)
+                << " images/s in detection calls, "
+                << (totalSeconds > 0 ? numImages / totalSeconds : 0)
+                << " images/s overall." << endl;
+
     /* Remove the input file */
     if( remove(inputFile.c_str()) != 0 )
         cerr << "Error deleting file: " << inputFile << endl;
@@ -197,11 +538,141 @@ detectMorph(
     return SUCCESS;
 }
 
+/* Decode statistics for one compare() worker */
+typedef struct DecodeStats {
+    uint64_t decodes{0};
+    uint64_t bytesRead{0};
+    double decodeSeconds{0.0};
+} DecodeStats;
+
+/* Features of one image, as cached by compare() */
+typedef struct ImageFeatures {
+    std::vector<uint8_t> features;
+    ReturnStatus status;
+} ImageFeatures;
+
+/* Maximum number of verification images sent in one compareFeatures() call */
+const size_t maxFeatureBatch{1024};
+
+void
+decodeImage(
+        const string &path,
+        Image &image,
+        DecodeStats &stats)
+{
+    auto start = chrono::steady_clock::now();
+    if (!readImage(path, image)) {
+        cerr << "Failed to load image file: " << path << "." << endl;
+        raise(SIGTERM);
+    }
+    stats.decodeSeconds += chrono::duration<double>(
+            chrono::steady_clock::now() - start).count();
+    stats.decodes++;
+    stats.bytesRead += image.size();
+}
+
+/* Load an image through the worker's decoded-image cache */
+void
+loadCachedImage(
+        LRUCache<string, Image> &cache,
+        const string &path,
+        Image &image,
+        DecodeStats &stats)
+{
+    auto cached = cache.get(path);
+    if (cached != nullptr) {
+        image = *cached;
+        return;
+    }
+    decodeImage(path, image, stats);
+    cache.put(path, image, image.size());
+}
+
+/* Extract features for an image, or fetch them from the worker's cache */
+ImageFeatures
+loadCachedFeatures(
+        std::shared_ptr<Interface> &implPtr,
+        LRUCache<string, ImageFeatures> &cache,
+        const string &path,
+        DecodeStats &stats)
+{
+    auto cached = cache.get(path);
+    if (cached != nullptr)
+        return *cached;
+
+    Image image;
+    decodeImage(path, image, stats);
+    ImageFeatures entry;
+    entry.status = perfCall("extractFeatures", [&] { return implPtr->extractFeatures(image, entry.features); });
+    cache.put(path, entry, sizeof(ImageFeatures) + entry.features.size());
+    return entry;
+}
+
+/* Compare one enrollment image against a run of verification images
+ * through the cached-features path and log one line per pair */
+void
+compareFeatureBatch(
+        std::shared_ptr<Interface> &implPtr,
+        LRUCache<string, ImageFeatures> &cache,
+        const string &enroll,
+        const vector<string> &verifs,
+        ofstream &scoresStream,
+        DecodeStats &stats)
+{
+    vector<double> similarities(verifs.size(), -1.0);
+    vector<ReturnStatus> statuses(verifs.size());
+
+    auto enrollFeatures = loadCachedFeatures(implPtr, cache, enroll, stats);
+    vector<vector<uint8_t>> verifFeatures;
+    vector<size_t> verifIndices;
+    for (size_t i = 0; i < verifs.size(); i++) {
+        if (enrollFeatures.status.code != ReturnCode::Success) {
+            statuses[i] = enrollFeatures.status;
+            continue;
+        }
+        auto features = loadCachedFeatures(implPtr, cache, verifs[i], stats);
+        if (features.status.code != ReturnCode::Success) {
+            statuses[i] = features.status;
+            continue;
+        }
+        verifFeatures.push_back(std::move(features.features));
+        verifIndices.push_back(i);
+    }
+
+    if (!verifFeatures.empty()) {
+        vector<double> scores;
+        auto ret = perfCall("compareFeatures", [&] { return implPtr->compareFeatures(enrollFeatures.features, verifFeatures, scores); });
+        if (ret.code == ReturnCode::NotImplemented) {
+            cerr << "[ERROR] extractFeatures() is implemented but compareFeatures() "
+                    "returned ReturnCode::NotImplemented.  Both must be implemented!" << endl;
+            raise(SIGTERM);
+        }
+        if (ret.code == ReturnCode::Success && scores.size() != verifFeatures.size()) {
+            cerr << "[ERROR] compareFeatures() returned " << scores.size()
+                    << " scores for " << verifFeatures.size() << " comparisons." << endl;
+            raise(SIGTERM);
+        }
+        for (size_t i = 0; i < verifIndices.size(); i++) {
+            statuses[verifIndices[i]] = ret;
+            if (ret.code == ReturnCode::Success)
+                similarities[verifIndices[i]] = scores[i];
+        }
+    }
+
+    for (size_t i = 0; i < verifs.size(); i++)
+        scoresStream << enroll << " "
+                << verifs[i] << " "
+                << similarities[i] << " "
+                << static_cast<std::underlying_type<ReturnCode>::type>(statuses[i].code)
+                << endl;
+}
+
 int
 compare(
         std::shared_ptr<Interface> &implPtr,
         const string &inputFile,
-        const string &scoresLog)
+        const string &scoresLog,
+        uint64_t cacheBytes)
 {
     /* Read probes */
     ifstream inputStream(inputFile);
@@ -219,38 +690,83 @@ compare(
     /* header */
     scoresStream << "enrollImage verifImage score returnCode" << endl;
 
+    /* Pair lists reuse the same images, so keep recently decoded ones
+     * (or, if the implementation supports it, their features) */
+    LRUCache<string, Image> imageCache(cacheBytes);
+    LRUCache<string, ImageFeatures> featureCache(cacheBytes);
+    DecodeStats stats;
+
     /* Process each probe */
     string enroll, verif;
     Image enrollImage, verifImage;
     ReturnStatus ret;
-    while (inputStream >> enroll >> verif) {
-        if (!readImage(enroll, enrollImage)) {
-            cerr << "Failed to load image file: " << enroll << "." << endl;
-            raise(SIGTERM);
-        }
-        if (!readImage(verif, verifImage)) {
-            cerr << "Failed to load image file: " << verif << "." << endl;
-            raise(SIGTERM);
+    bool useFeatures = false;
+    if (inputStream >> enroll >> verif) {
+        /* Probe once for the extract-once/compare-many path */
+        auto probe = loadCachedFeatures(implPtr, featureCache, enroll, stats);
+        useFeatures = (probe.status.code != ReturnCode::NotImplemented);
+        inputStream.clear();
+        inputStream.seekg(0, ios::beg);
+    }
+
+    if (useFeatures) {
+        /* Consecutive pairs sharing an enrollment image form one batch */
+        string batchEnroll;
+        vector<string> batchVerifs;
+        while (inputStream >> enroll >> verif) {
+            if ((enroll != batchEnroll || batchVerifs.size() == maxFeatureBatch) &&
+                    !batchVerifs.empty()) {
+                compareFeatureBatch(implPtr, featureCache, batchEnroll,
+                        batchVerifs, scoresStream, stats);
+                batchVerifs.clear();
+            }
+            batchEnroll = enroll;
+            batchVerifs.push_back(verif);
         }
+        if (!batchVerifs.empty())
+            compareFeatureBatch(implPtr, featureCache, batchEnroll,
+                    batchVerifs, scoresStream, stats);
+        ret = ReturnStatus(ReturnCode::Success);
+    } else {
+        while (inputStream >> enroll >> verif) {
+            loadCachedImage(imageCache, enroll, enrollImage, stats);
+            loadCachedImage(imageCache, verif, verifImage, stats);
 
-        double similarity = -1.0;
-        /* Call compare */
-        ret = implPtr->compareImages(enrollImage, verifImage, similarity);
+            double similarity = -1.0;
+            /* Call compare */
+            ret = perfCall("compareImages", [&] { return implPtr->compareImages(enrollImage, verifImage, similarity); });
 
-        /* If function is not implemented, clean up and exit */
-        if (ret.code == ReturnCode::NotImplemented) {
-            break;
-        }
+            /* If function is not implemented, clean up and exit */
+            if (ret.code == ReturnCode::NotImplemented) {
+                break;
+            }
 
-        /* Write to scores log file */
-        scoresStream << enroll << " "
-                << verif << " "
-                << similarity << " "
-                << static_cast<std::underlying_type<ReturnCode>::type>(ret.code)
-                << endl;
+            /* Write to scores log file */
+            scoresStream << enroll << " "
+                    << verif << " "
+                    << similarity << " "
+                    << static_cast<std::underlying_type<ReturnCode>::type>(ret.code)
+                    << endl;
+        }
     }
     inputStream.close();
 
+    /* Report what the cache saved relative to decoding every image */
+    auto hits = useFeatures ? featureCache.getHits() : imageCache.getHits();
+    auto lookups = hits + (useFeatures ? featureCache.getMisses() : imageCache.getMisses());
+    auto evictions = useFeatures ? featureCache.getEvictions() : imageCache.getEvictions();
+    if (lookups > 0 && stats.decodes > 0) {
+        double avgBytes = (double)stats.bytesRead / stats.decodes;
+        double avgSeconds = stats.decodeSeconds / stats.decodes;
+        cerr << "[INFO] " << scoresLog << ": " << lookups
+                << (useFeatures ? " feature" : " image") << " loads, "
+                << hits << " cache hits (" << (100.0 * hits / lookups) << "%), "
+                << evictions << " evictions; decoded "
+                << stats.bytesRead << " bytes in " << stats.decodeSeconds
+                << " s, saved ~" << (uint64_t)(avgBytes * hits) << " bytes and ~"
+                << (avgSeconds * hits) << " s of decoding." << endl;
+    }
+
     /* Remove the input file */
     if( remove(inputFile.c_str()) != 0 )
         cerr << "Error deleting file: " << inputFile << endl;
@@ -266,6 +782,21 @@ compare(
     return SUCCESS;
 }
 
+/* --io-only: load the image, and the second image if the action takes
+ * one, of one input line, without calling the implementation.  Compare
+ * loads both images of every pair, bypassing the decoded-image cache. */
+void
+loadOnly(
+        const string &line,
+        bool secondImage,
+        IOProbe &probe)
+{
+    auto imgs = split(line, ' ');
+    Image image;
+    for (unsigned int i = 0; i < (secondImage ? 2U : 1U) && i < imgs.size(); i++)
+        probe.load(imgs[i], [&] { return readImage(imgs[i], image); });
+}
+
 void usage(const string &executable)
 {
     cerr << "Usage: " << executable <<
@@ -278,10 +809,14 @@ void usage(const string &executable)
             "|detectNonScannedMorphWithProbeImgAndMeta"
             "|detectScannedMorphWithProbeImgAndMeta"
             "|detectUnknownMorphWithProbeImgAndMeta"
+            "|detectMorphMulti"
             "|compare"
             "|demorph"
             "|demorphDifferentially -c configDir "
-            "-o outputDir -h outputStem -i inputFile -t numForks" << endl;
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() << " "
+            "[-f pnm|png] [-w numWriterThreads] "
+            "[-k imageCacheMB] [-s] [-b batchSize] "
+            "[-m detectAction,detectAction,...]" << endl;
     exit(EXIT_FAILURE);
 }
 
@@ -290,10 +825,9 @@ main(
         int argc,
         char* argv[])
 {
-    auto exitStatus = SUCCESS;
 
     uint16_t currAPIMajorVersion{5},
-		currAPIMinorVersion{0},
+		currAPIMinorVersion{2},
 		currStructsMajorVersion{3},
 		currStructsMinorVersion{0};
 
@@ -330,7 +864,13 @@ main(
         outputDir{"output"},
         outputFileStem{"stem"},
         inputFile;
-    int numForks = 1;
+    ExecutionOptions execution;
+    ImageFormat imageFormat = ImageFormat::PNM;
+    unsigned int numWriters = 1;
+    uint64_t imageCacheMB = 256;
+    bool sortPairs = false;
+    unsigned int batchSize = 0;
+    vector<Action> variants;
 
     for (int i = 0; i < argc - requiredArgs; i++) {
         if (strcmp(argv[requiredArgs+i],"-c") == 0)
@@ -343,9 +883,32 @@ main(
             outputFileStem = argv[requiredArgs+(++i)];
         else if (strcmp(argv[requiredArgs+i],"-i") == 0)
             inputFile = argv[requiredArgs+(++i)];
-        else if (strcmp(argv[requiredArgs+i],"-t") == 0)
-            numForks = atoi(argv[requiredArgs+(++i)]);
-        else {
+        else if (strcmp(argv[requiredArgs+i],"-f") == 0) {
+            string formatstr{argv[requiredArgs+(++i)]};
+            if (mapStringToImageFormat.find(formatstr) == mapStringToImageFormat.end()) {
+                cerr << "Unknown image format: " << formatstr << endl;
+                usage(argv[0]);
+            }
+            imageFormat = mapStringToImageFormat[formatstr];
+        } else if (strcmp(argv[requiredArgs+i],"-w") == 0)
+            numWriters = atoi(argv[requiredArgs+(++i)]);
+        else if (strcmp(argv[requiredArgs+i],"-k") == 0)
+            imageCacheMB = atoi(argv[requiredArgs+(++i)]);
+        else if (strcmp(argv[requiredArgs+i],"-s") == 0)
+            sortPairs = true;
+        else if (strcmp(argv[requiredArgs+i],"-b") == 0)
+            batchSize = atoi(argv[requiredArgs+(++i)]);
+        else if (strcmp(argv[requiredArgs+i],"-m") == 0) {
+            for (const auto &name : split(argv[requiredArgs+(++i)], ',')) {
+                auto it = mapStringToAction.find(name);
+                if (it == mapStringToAction.end() ||
+                        mapActionToMorphLabel.find(it->second) == mapActionToMorphLabel.end()) {
+                    cerr << "Unknown detection action: " << name << endl;
+                    usage(argv[0]);
+                }
+                variants.push_back(it->second);
+            }
+        } else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
             cerr << "Unrecognized flag: " << argv[requiredArgs+i] << endl;;
             usage(argv[0]);
         }
@@ -362,6 +925,7 @@ main(
         case Action::DetectNonScannedMorphWithProbeImgAndMeta:
         case Action::DetectScannedMorphWithProbeImgAndMeta:
         case Action::DetectUnknownMorphWithProbeImgAndMeta:
+        case Action::DetectMorphMulti:
         case Action::Compare:
         case Action::Demorph:
         case Action::DemorphDifferentially:
@@ -371,84 +935,122 @@ main(
             usage(argv[0]);
     }
 
-    /* Get implementation pointer */
-    auto implPtr = Interface::getImplementation();
-    /* Initialization */
-    auto ret = implPtr->initialize(configDir, configValue);
-    if (ret.code != ReturnCode::Success) {
-        cerr << "initialize() returned error code: "
-                << ret.code << "." << endl;
+    /* By default, the multi-action mode runs every detection variant */
+    if (action == Action::DetectMorphMulti && variants.empty())
+        for (const auto &entry : mapActionToMorphLabel)
+            variants.push_back(entry.first);
+
+    if (!ImageSink::isSupported(imageFormat)) {
+        cerr << "This build of " << argv[0] << " was compiled without "
+                "PNG support (zlib not found)." << endl;
         return FAILURE;
     }
 
-    /* Split input file into appropriate number of splits */
-    vector<string> inputFileVector;
-    if (splitInputFile(inputFile, outputDir, numForks, inputFileVector) != SUCCESS) {
-        cerr << "An error occurred with processing the input file." << endl;
-        return FAILURE;
+    /* Get implementation pointer; --io-only never calls it */
+    std::shared_ptr<Interface> implPtr;
+    if (!execution.ioOnly) {
+        implPtr = Interface::getImplementation();
+        /* Initialization */
+        auto ret = implPtr->initialize(configDir, configValue);
+        if (ret.code != ReturnCode::Success) {
+            cerr << "initialize() returned error code: "
+                    << ret.code << "." << endl;
+            return FAILURE;
+        }
+    }
+
+    /* Group compare pairs by enrollment image so cached images are reused */
+    string sortedInputFile;
+    if (action == Action::Compare && sortPairs) {
+        sortedInputFile = outputDir + "/input.sorted.txt";
+        if (sortInputFile(inputFile, sortedInputFile, 0) != SUCCESS) {
+            cerr << "An error occurred with sorting the input file." << endl;
+            return FAILURE;
+        }
+        inputFile = sortedInputFile;
     }
 
-    bool parent = false;
-	int i = 0;
-    for (auto &inputFile : inputFileVector) {
-		/* Fork */
-		switch(fork()) {
-		case 0: /* Child */
-            switch (action) {
-                case Action::DetectNonScannedMorph:
-                case Action::DetectScannedMorph:
-                case Action::DetectUnknownMorph:
-                case Action::DetectNonScannedMorphWithProbeImg:
-                case Action::DetectScannedMorphWithProbeImg:
-                case Action::DetectUnknownMorphWithProbeImg:
-                case Action::DetectNonScannedMorphWithProbeImgAndMeta:
-                case Action::DetectScannedMorphWithProbeImgAndMeta:
-                case Action::DetectUnknownMorphWithProbeImgAndMeta:
-                case Action::Demorph:
-                case Action::DemorphDifferentially:
-                    return detectMorph(
+    /* Count records up front, since workers delete their input splits */
+    size_t numRecords{0};
+    {
+        ifstream countStream(inputFile);
+        string line;
+        while (std::getline(countStream, line))
+            numRecords++;
+    }
+
+    /* Whether each input line names a second (probe or verification) image */
+    bool secondImage = (usesProbeImage(action) ||
+            action == Action::DemorphDifferentially || action == Action::Compare);
+    for (const auto &variant : variants)
+        secondImage |= usesProbeImage(variant);
+
+    /* Run the requested action on one input split */
+    auto runAction = [&](const string &inputFile, int i) -> int {
+        if (execution.ioOnly)
+            return loadInputOnly(inputFile, ioProbePath(outputDir, i),
+                [secondImage](const string &line, IOProbe &probe) {
+                    loadOnly(line, secondImage, probe); });
+        switch (action) {
+            case Action::DetectNonScannedMorph:
+            case Action::DetectScannedMorph:
+            case Action::DetectUnknownMorph:
+            case Action::DetectNonScannedMorphWithProbeImg:
+            case Action::DetectScannedMorphWithProbeImg:
+            case Action::DetectUnknownMorphWithProbeImg:
+            case Action::DetectNonScannedMorphWithProbeImgAndMeta:
+            case Action::DetectScannedMorphWithProbeImgAndMeta:
+            case Action::DetectUnknownMorphWithProbeImgAndMeta:
+                /* With -b, dispatch through the batched entry points */
+                if (batchSize > 0)
+                    return detectMorphBatched(
                             implPtr,
                             inputFile,
                             outputDir + "/" + outputFileStem + ".log." + to_string(i),
                             action,
-                            outputDir);
-                case Action::Compare:
-                    return compare(
-                            implPtr,
-                            inputFile,
-                            outputDir + "/" + outputFileStem + ".log." + to_string(i));
-				default:
-					return FAILURE;
-            }
-		case -1: /* Error */
-			cerr << "Problem forking" << endl;
-			break;
-		default: /* Parent */
-			parent = true;
-			break;
-		}
-		i++;
-	}
-
-    /* Parent -- wait for children */
-    if (parent) {
-        while (numForks > 0) {
-            int stat_val;
-            pid_t cpid;
-
-            cpid = wait(&stat_val);
-            if (WIFEXITED(stat_val)) { exitStatus = WEXITSTATUS(stat_val); }
-            else if (WIFSIGNALED(stat_val)) {
-                cerr << "PID " << cpid << " exited due to signal " <<
-                        WTERMSIG(stat_val) << endl;
-                exitStatus = FAILURE;
-            } else {
-                cerr << "PID " << cpid << " exited with unknown status." << endl;
-                exitStatus = FAILURE;
-            }
-            numForks--;
+                            batchSize);
+                /* Fall through */
+            case Action::Demorph:
+            case Action::DemorphDifferentially:
+                return detectMorph(
+                        implPtr,
+                        inputFile,
+                        outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                        action,
+                        outputDir,
+                        imageFormat,
+                        numWriters);
+            case Action::DetectMorphMulti:
+                return detectMorphMulti(
+                        implPtr,
+                        inputFile,
+                        outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                        variants);
+            case Action::Compare:
+                return compare(
+                        implPtr,
+                        inputFile,
+                        outputDir + "/" + outputFileStem + ".log." + to_string(i),
+                        imageCacheMB * 1024 * 1024);
+            default:
+                return FAILURE;
         }
-    }
+    };
+
+    ExecutionReport report;
+    auto exitStatus = runWorkers(inputFile, outputDir, execution, runAction,
+            {MergeOutput(outputDir + "/" + outputFileStem + ".log")}, &report);
+    if (!sortedInputFile.empty() && remove(sortedInputFile.c_str()) != 0)
+        cerr << "Error deleting file: " << sortedInputFile << endl;
+
+    if (report.numWorkers > 0)
+        cerr << "[INFO] " << mapExecutionModeToString[report.mode] << " mode, "
+                << report.numWorkers << " workers: " << numRecords << " records in "
+                << report.seconds << " s ("
+                << (report.seconds > 0 ? numRecords / report.seconds : 0)
+                << " records/s), peak RSS " << report.peakRSSKB / 1024 << " MB"
+                << (report.mode == ExecutionMode::Process ? " (summed over processes)" : "")
+                << "." << endl;
 
     return exitStatus;
 }
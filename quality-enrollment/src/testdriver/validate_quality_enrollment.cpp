@@ -0,0 +1,399 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <csignal>
+
+#include "execution.h"
+#include "frvt_quality.h"
+#include "frvt1N.h"
+#include "io_probe.h"
+#include "perf_counters.h"
+#include "util.h"
+
+using namespace std;
+using namespace FRVT;
+
+/* Both APIs declare an Interface, so they are referred to by namespace */
+using QualityInterface = FRVT_QUALITY::Interface;
+using EnrollInterface = FRVT_1N::Interface;
+using FRVT_QUALITY::QualityMeasure;
+using FRVT_QUALITY::QualityAssessments;
+
+/* Write one image's quality results in the validate_quality format,
+ * followed by whether the image passed the quality gate */
+void
+logQuality(
+    ofstream &logStream,
+    const string &id,
+    const string &imagePath,
+    const ReturnStatus &status,
+    const FRVT_QUALITY::ImageQualityAssessment &assessment,
+    bool passedGate)
+{
+    logStream << id << " "
+        << imagePath << " "
+        << static_cast<std::underlying_type<ReturnCode>::type>(status.code) << " ";
+
+    const auto &detection = assessment.qAssessments;
+    const auto &bb = assessment.boundingBox;
+    logStream << bb.xleft << " " << bb.ytop << " " << bb.width << " " << bb.height;
+    char value[64];
+    for (size_t m = 0; m < QualityAssessments::NumMeasures; m++) {
+        if (detection.count(QualityMeasure(m))) {
+            snprintf(value, sizeof(value), " %f", detection.at(QualityMeasure(m)));
+            logStream << value;
+        } else
+            logStream << " NA";
+    }
+    logStream << " " << passedGate << '\n';
+}
+
+int
+qualityGatedEnroll(
+    shared_ptr<QualityInterface> &qualityPtr,
+    shared_ptr<EnrollInterface> &enrollPtr,
+    const string &inputFile,
+    const string &qualityLog,
+    const string &enrollLog,
+    const string &edb,
+    const string &manifest,
+    double minQuality)
+{
+    /* Read input file */
+    ifstream inputStream(inputFile);
+    if (!inputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << inputFile << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* Open output logs for writing */
+    ofstream qualityStream(qualityLog);
+    if (!qualityStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << qualityLog << "." << endl;
+        raise(SIGTERM);
+    }
+    ofstream logStream(enrollLog);
+    if (!logStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << enrollLog << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* headers */
+    qualityStream << "id image returnCode bb_xleft bb_ytop bb_width bb_height ";
+    for (QualityMeasure e = QualityMeasure::Begin; e != QualityMeasure::End; ++e)
+        qualityStream << e << " ";
+    qualityStream << "passedGate" << endl;
+    logStream << "id image templateSizeBytes returnCode isLeftEyeAssigned "
+        "isRightEyeAssigned xleft yleft xright yright" << endl;
+
+    /* Open EDB file for writing */
+    ofstream edbStream(edb);
+    if (!edbStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << edb << "." << endl;
+        raise(SIGTERM);
+    }
+
+    /* Open manifest for writing */
+    ofstream manifestStream(manifest);
+    if (!manifestStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << manifest << "." << endl;
+        raise(SIGTERM);
+    }
+
+    FRVT_QUALITY::QualityMeasureSet requested;
+    requested.set();
+
+    vector<FRVT_QUALITY::ImageQualityAssessment> assessments;
+    vector<ReturnStatus> statuses;
+    size_t numImages{0}, numPassed{0}, numEntries{0}, numEnrolled{0};
+    string line;
+    ReturnStatus ret;
+    while (std::getline(inputStream, line)) {
+        auto tokens = split(line, ' ');
+        auto id = tokens[0];
+        numEntries++;
+
+        /* Each image is decoded once and shared by both APIs */
+        vector<Image> images;
+        vector<string> imagePaths;
+        for (unsigned int i = 0; i < (tokens.size() - 1) / 2; i++) {
+            Image image;
+            string imagePath = tokens[(i*2)+1];
+            string desc = tokens[(i*2)+2];
+            if (!readImage(imagePath, image)) {
+                cerr << "[ERROR] Failed to load image file: " << imagePath << "." << endl;
+                raise(SIGTERM);
+            }
+            image.description = toImageDescription(desc);
+            images.push_back(image);
+            imagePaths.push_back(imagePath);
+        }
+        numImages += images.size();
+
+        ret = perfCall("vectorQualityBatch", [&] { return qualityPtr->vectorQualityBatch(images, requested, assessments, statuses); });
+        if (ret.code == ReturnCode::NotImplemented)
+            break;
+        if (ret.code != ReturnCode::Success) {
+            /* Treat a failed batch as every image failing */
+            assessments.assign(images.size(), FRVT_QUALITY::ImageQualityAssessment{});
+            statuses.assign(images.size(), ret);
+        } else if (assessments.size() != images.size() || statuses.size() != images.size()) {
+            cerr << "[ERROR] vectorQualityBatch() returned " << assessments.size() <<
+                    " assessments and " << statuses.size() << " statuses for " <<
+                    images.size() << " images." << endl;
+            raise(SIGTERM);
+        }
+
+        /* Only images whose quality exceeds the threshold are enrolled */
+        vector<Image> gated;
+        vector<string> gatedPaths;
+        for (size_t i = 0; i < images.size(); i++) {
+            if (statuses[i].code == ReturnCode::NotImplemented) {
+                ret = statuses[i];
+                break;
+            }
+            const auto &detection = assessments[i].qAssessments;
+            bool passed = (statuses[i].code == ReturnCode::Success &&
+                    detection.count(QualityMeasure::UnifiedQualityScore) &&
+                    detection.at(QualityMeasure::UnifiedQualityScore) > minQuality);
+            logQuality(qualityStream, id, imagePaths[i], statuses[i],
+                    assessments[i], passed);
+            if (passed) {
+                gated.push_back(images[i]);
+                gatedPaths.push_back(imagePaths[i]);
+            }
+        }
+        if (ret.code == ReturnCode::NotImplemented)
+            break;
+        numPassed += gated.size();
+        if (gated.empty())
+            continue;
+
+        vector<uint8_t> templ;
+        vector<EyePair> eyes;
+        ret = perfCall("createFaceTemplate", [&] { return enrollPtr->createFaceTemplate(gated, TemplateRole::Enrollment_1N, templ, eyes); });
+
+        /* If function is not implemented, clean up and exit */
+        if (ret.code == ReturnCode::NotImplemented)
+            break;
+        numEnrolled++;
+
+        /* Write to edb and manifest */
+        manifestStream << id << " "
+                << templ.size() << " "
+                << edbStream.tellp() << endl;
+        edbStream.write(
+                (char*)templ.data(),
+                templ.size());
+
+        if (gated.size() != eyes.size()) {
+            eyes.clear();
+            eyes.resize(gated.size(), EyePair());
+        }
+
+        for (unsigned int i = 0; i < gated.size(); i++) {
+            /* Write template stats to log */
+            logStream << id << " "
+                    << gatedPaths[i] << " "
+                    << templ.size() << " "
+                    << static_cast<std::underlying_type<ReturnCode>::type>(ret.code) << " "
+                    << eyes[i].isLeftAssigned << " "
+                    << eyes[i].isRightAssigned << " "
+                    << eyes[i].xleft << " "
+                    << eyes[i].yleft << " "
+                    << eyes[i].xright << " "
+                    << eyes[i].yright << endl;
+        }
+    }
+    inputStream.close();
+
+    /* Remove the input file */
+    if( remove(inputFile.c_str()) != 0 )
+        cerr << "Error deleting file: " << inputFile << endl;
+
+    if (ret.code == ReturnCode::NotImplemented) {
+        /* Remove the output files */
+        qualityStream.close();
+        logStream.close();
+        if( remove(qualityLog.c_str()) != 0 )
+            cerr << "Error deleting file: " << qualityLog << endl;
+        if( remove(enrollLog.c_str()) != 0 )
+            cerr << "Error deleting file: " << enrollLog << endl;
+        return NOT_IMPLEMENTED;
+    }
+
+    cerr << "[INFO] " << enrollLog << ": " << numPassed << " of " << numImages
+            << " images passed the quality gate (UnifiedQualityScore > "
+            << minQuality << "); " << numEnrolled << " of " << numEntries
+            << " entries enrolled." << endl;
+    return SUCCESS;
+}
+
+/* --io-only: load the images of one input line as qualityGatedEnroll()
+ * does, without calling either implementation */
+void
+loadOnly(
+        const string &line,
+        IOProbe &probe)
+{
+    auto tokens = split(line, ' ');
+    Image image;
+    for (unsigned int i = 0; i < tokens.size()/2; i++) {
+        string imagePath = tokens[(i*2)+1];
+        probe.load(imagePath, [&] { return readImage(imagePath, image); });
+    }
+}
+
+void usage(const string &executable)
+{
+    cerr << "Usage: " << executable << " qualityGatedEnroll_1N -c configDir "
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() << " "
+            "-q minUnifiedQualityScore" << endl;
+    exit(EXIT_FAILURE);
+}
+
+int
+main(
+        int argc,
+        char* argv[])
+{
+
+    uint16_t currQualityAPIMajorVersion{5},
+        currQualityAPIMinorVersion{0},
+        curr1NAPIMajorVersion{3},
+        curr1NAPIMinorVersion{0},
+        currStructsMajorVersion{3},
+        currStructsMinorVersion{0};
+
+    /* Check versioning of frvt_structs.h and both API header files */
+    if ((FRVT::FRVT_STRUCTS_MAJOR_VERSION != currStructsMajorVersion) ||
+            (FRVT::FRVT_STRUCTS_MINOR_VERSION != currStructsMinorVersion)) {
+        cerr << "[ERROR] You've compiled your library with an old version of the frvt_structs.h file: version " <<
+            FRVT::FRVT_STRUCTS_MAJOR_VERSION << "." <<
+            FRVT::FRVT_STRUCTS_MINOR_VERSION <<
+            ".  Please re-build with the latest version: " <<
+            currStructsMajorVersion << "." <<
+            currStructsMinorVersion << "." << endl;
+        return (FAILURE);
+    }
+
+    if ((FRVT_QUALITY::API_MAJOR_VERSION != currQualityAPIMajorVersion) ||
+            (FRVT_QUALITY::API_MINOR_VERSION != currQualityAPIMinorVersion)) {
+        cerr << "[ERROR] You've compiled your quality library with an old version of the API header file: " <<
+            FRVT_QUALITY::API_MAJOR_VERSION << "." <<
+            FRVT_QUALITY::API_MINOR_VERSION <<
+            ".  Please re-build with the latest version: " <<
+            currQualityAPIMajorVersion << "." <<
+            currQualityAPIMinorVersion << "." << endl;
+        return (FAILURE);
+    }
+
+    if ((FRVT_1N::API_MAJOR_VERSION != curr1NAPIMajorVersion) ||
+            (FRVT_1N::API_MINOR_VERSION != curr1NAPIMinorVersion)) {
+        cerr << "[ERROR] You've compiled your 1:N library with an old version of the API header file: " <<
+            FRVT_1N::API_MAJOR_VERSION << "." <<
+            FRVT_1N::API_MINOR_VERSION <<
+            ".  Please re-build with the latest version: " <<
+            curr1NAPIMajorVersion << "." <<
+            curr1NAPIMinorVersion << "." << endl;
+        return (FAILURE);
+    }
+
+    int requiredArgs = 2; /* exec name and action */
+    if (argc < requiredArgs)
+        usage(argv[0]);
+
+    string actionstr{argv[1]},
+        configDir{"config"},
+        outputDir{"output"},
+        outputFileStem{"stem"},
+        inputFile;
+    ExecutionOptions execution;
+    double minQuality = 0.0;
+
+    for (int i = 0; i < argc - requiredArgs; i++) {
+        if (strcmp(argv[requiredArgs+i],"-c") == 0)
+            configDir = argv[requiredArgs+(++i)];
+        else if (strcmp(argv[requiredArgs+i],"-o") == 0)
+            outputDir = argv[requiredArgs+(++i)];
+        else if (strcmp(argv[requiredArgs+i],"-h") == 0)
+            outputFileStem = argv[requiredArgs+(++i)];
+        else if (strcmp(argv[requiredArgs+i],"-i") == 0)
+            inputFile = argv[requiredArgs+(++i)];
+        else if (strcmp(argv[requiredArgs+i],"-q") == 0)
+            minQuality = atof(argv[requiredArgs+(++i)]);
+        else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
+            cerr << "[ERROR] Unrecognized flag: " << argv[requiredArgs+i] << endl;;
+            usage(argv[0]);
+        }
+    }
+
+    Action action = mapStringToAction[actionstr];
+    switch(action) {
+        case Action::QualityGatedEnroll_1N:
+            break;
+        default:
+            cerr << "Unknown command: " << actionstr << endl;
+            usage(argv[0]);
+    }
+
+    /* Get implementation pointers and initialize both; --io-only never
+     * calls them */
+    std::shared_ptr<QualityInterface> qualityPtr;
+    std::shared_ptr<EnrollInterface> enrollPtr;
+    if (!execution.ioOnly) {
+        qualityPtr = QualityInterface::getImplementation();
+        auto ret = qualityPtr->initialize(configDir);
+        if (ret.code != ReturnCode::Success) {
+            cerr << "[ERROR] initialize() returned error: "
+                    << ret.code << "." << endl;
+            return FAILURE;
+        }
+        enrollPtr = EnrollInterface::getImplementation();
+        ret = enrollPtr->initializeTemplateCreation(configDir, TemplateRole::Enrollment_1N);
+        if (ret.code != ReturnCode::Success) {
+            cerr << "[ERROR] initializeTemplateCreation(TemplateRole::Enrollment_1N) returned error code: "
+                    << ret.code << "." << endl;
+            return FAILURE;
+        }
+    }
+
+    /* Run quality-gated enrollment on one input split.  The EDB and
+     * manifest are named as by validate1N enroll_1N, so finalize_1N can
+     * be run on outputDir as usual. */
+    auto qualityLog = mapActionToString[Action::VectorQ],
+        enrollLog = mapActionToString[Action::Enroll_1N];
+    auto runAction = [&](const string &inputFile, int i) -> int {
+        if (execution.ioOnly)
+            return loadInputOnly(inputFile, ioProbePath(outputDir, i), loadOnly);
+        return qualityGatedEnroll(
+                qualityPtr,
+                enrollPtr,
+                inputFile,
+                outputDir + "/" + outputFileStem + "." + qualityLog + "." + to_string(i),
+                outputDir + "/" + outputFileStem + "." + enrollLog + "." + to_string(i),
+                outputDir + "/edb." + to_string(i),
+                outputDir + "/manifest." + to_string(i),
+                minQuality);
+    };
+
+    return runWorkers(inputFile, outputDir, execution, runAction, {
+            MergeOutput(outputDir + "/" + outputFileStem + "." + qualityLog),
+            MergeOutput(outputDir + "/" + outputFileStem + "." + enrollLog),
+            MergeOutput(outputDir + "/edb", MergeFormat::Concatenate),
+            MergeOutput(outputDir + "/manifest", MergeFormat::Manifest, 0,
+                outputDir + "/edb")});
+}
@@ -11,7 +11,12 @@
 #ifndef FRVT_QUALITY_H_
 #define FRVT_QUALITY_H_
 
+#include <array>
+#include <bitset>
 #include <cstdint>
+#include <iterator>
+#include <map>
+#include <stdexcept>
 #include <string>
 #include <vector>
 
@@ -120,12 +125,230 @@ operator<<(
     }
 }
 
+/**
+ * @brief
+ * Set of quality measures, indexed by QualityMeasure, that the caller
+ * requests from vectorQualityBatch()
+ */
+using QualityMeasureSet = std::bitset<
+    static_cast<size_t>(QualityMeasure::End)>;
+
 /**
  * @brief
  * Data structure that stores key-value pairs, with each
  * entry representing a quality element and its value
+ *
+ * @details
+ * Values are held in a fixed-size array indexed by QualityMeasure, with
+ * a bitmask recording which measures are present, so populating and
+ * reading an assessment does not allocate.  The interface mirrors the
+ * parts of std::map<QualityMeasure, double> used by implementations
+ * (operator[], at(), find(), count(), erase(), and const iteration in
+ * QualityMeasure order), and converts to and from that map type.
  */
-using QualityAssessments = std::map<QualityMeasure, double>;
+class QualityAssessments {
+public:
+    /** Number of distinct QualityMeasure values */
+    static constexpr size_t NumMeasures =
+        static_cast<size_t>(QualityMeasure::End);
+
+    /** Read-only iterator over present measures, in enum order */
+    class const_iterator {
+    public:
+        using value_type = std::pair<QualityMeasure, double>;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using difference_type = std::ptrdiff_t;
+        using iterator_category = std::forward_iterator_tag;
+
+        const_iterator() : owner{nullptr}, index{NumMeasures} {}
+
+        reference operator*() const { return this->current; }
+        pointer operator->() const { return &this->current; }
+
+        const_iterator&
+        operator++()
+        {
+            this->index = this->owner->nextPresent(this->index + 1);
+            this->load();
+            return *this;
+        }
+
+        const_iterator
+        operator++(int)
+        {
+            auto prev = *this;
+            ++(*this);
+            return prev;
+        }
+
+        bool
+        operator==(const const_iterator &rhs) const
+        { return (this->index == rhs.index); }
+
+        bool
+        operator!=(const const_iterator &rhs) const
+        { return (this->index != rhs.index); }
+
+    private:
+        friend class QualityAssessments;
+
+        const_iterator(
+            const QualityAssessments *owner,
+            size_t index) :
+            owner{owner},
+            index{index}
+        { this->load(); }
+
+        void
+        load()
+        {
+            if (this->index < NumMeasures)
+                this->current = value_type(QualityMeasure(this->index),
+                    this->owner->values[this->index]);
+        }
+
+        const QualityAssessments *owner;
+        size_t index;
+        value_type current;
+    };
+    using iterator = const_iterator;
+
+    QualityAssessments() : values{}, present{} {}
+
+    /** Conversion from the std::map representation */
+    QualityAssessments(const std::map<QualityMeasure, double> &measures) :
+        values{},
+        present{}
+    {
+        for (const auto &measure : measures)
+            (*this)[measure.first] = measure.second;
+    }
+
+    /** Conversion to the std::map representation */
+    operator std::map<QualityMeasure, double>() const
+    { return this->toMap(); }
+
+    std::map<QualityMeasure, double>
+    toMap() const
+    {
+        std::map<QualityMeasure, double> measures;
+        for (const auto &measure : *this)
+            measures.insert(measure);
+        return measures;
+    }
+
+    /** Access a measure, marking it present (value-initialized if new) */
+    double&
+    operator[](QualityMeasure measure)
+    {
+        auto i = checkedIndex(measure);
+        if (!this->present.test(i)) {
+            this->present.set(i);
+            this->values[i] = 0.0;
+        }
+        return this->values[i];
+    }
+
+    /** @throw std::out_of_range if measure is not present */
+    double
+    at(QualityMeasure measure) const
+    {
+        if (this->count(measure) == 0)
+            throw std::out_of_range("QualityAssessments::at()");
+        return this->values[static_cast<size_t>(measure)];
+    }
+
+    /** Compile-time indexed access, marking the measure present */
+    template<QualityMeasure M>
+    double&
+    get()
+    {
+        static_assert(static_cast<size_t>(M) < NumMeasures,
+            "QualityAssessments::get<>() requires a valid QualityMeasure");
+        if (!this->present.test(static_cast<size_t>(M))) {
+            this->present.set(static_cast<size_t>(M));
+            this->values[static_cast<size_t>(M)] = 0.0;
+        }
+        return this->values[static_cast<size_t>(M)];
+    }
+
+    /** Compile-time indexed read of a measure that must be present */
+    template<QualityMeasure M>
+    double
+    get() const
+    {
+        static_assert(static_cast<size_t>(M) < NumMeasures,
+            "QualityAssessments::get<>() requires a valid QualityMeasure");
+        return this->at(M);
+    }
+
+    size_t
+    count(QualityMeasure measure) const
+    {
+        auto i = static_cast<size_t>(measure);
+        return ((i < NumMeasures && this->present.test(i)) ? 1 : 0);
+    }
+
+    const_iterator
+    find(QualityMeasure measure) const
+    {
+        return (this->count(measure) ?
+            const_iterator(this, static_cast<size_t>(measure)) : this->end());
+    }
+
+    size_t
+    erase(QualityMeasure measure)
+    {
+        auto removed = this->count(measure);
+        if (removed)
+            this->present.reset(static_cast<size_t>(measure));
+        return removed;
+    }
+
+    /** Remove every measure that is not in keep */
+    void
+    retain(const QualityMeasureSet &keep)
+    { this->present &= keep; }
+
+    /** Set of measures currently present */
+    const QualityMeasureSet&
+    measures() const
+    { return this->present; }
+
+    void clear() { this->present.reset(); }
+    size_t size() const { return this->present.count(); }
+    bool empty() const { return this->present.none(); }
+
+    const_iterator
+    begin() const
+    { return const_iterator(this, this->nextPresent(0)); }
+
+    const_iterator
+    end() const
+    { return const_iterator(this, NumMeasures); }
+
+private:
+    static size_t
+    checkedIndex(QualityMeasure measure)
+    {
+        auto i = static_cast<size_t>(measure);
+        if (i >= NumMeasures)
+            throw std::out_of_range("QualityAssessments::operator[]");
+        return i;
+    }
+
+    size_t
+    nextPresent(size_t from) const
+    {
+        while (from < NumMeasures && !this->present.test(from))
+            from++;
+        return from;
+    }
+
+    std::array<double, NumMeasures> values;
+    QualityMeasureSet present;
+};
 
 typedef struct BoundingBox
 {
@@ -226,6 +449,49 @@ public:
         const FRVT::Image &image,
         FRVT_QUALITY::ImageQualityAssessment &assessments) = 0;
 
+    /**
+     * @brief This function is the batched form of vectorQuality().  It
+     * takes a batch of images and the set of quality measures the caller
+     * needs, and outputs an assessment and return status for each image.
+     * Implementations may skip computing any measure that is not
+     * requested (e.g., occlusion or compression artifact detectors).
+     *
+     * The default implementation calls the single-image vectorQuality()
+     * for each image in the batch and removes unrequested measures from
+     * the results.  Implementations that can process batches natively or
+     * skip unrequested measures should override this function.
+     *
+     * @param[in] images
+     * Single face images
+     * @param[in] requested
+     * Quality measures to populate; measures not in this set need not
+     * be present in the output
+     * @param[out] assessments
+     * One ImageQualityAssessment per input image, in the same order
+     * @param[out] statuses
+     * One return status per input image, in the same order
+     *
+     * @return
+     * ReturnCode::Success if the batch was processed (per-image failures
+     * are reported in statuses); an error code if the batch as a whole
+     * could not be processed
+     */
+    virtual FRVT::ReturnStatus
+    vectorQualityBatch(
+        const std::vector<FRVT::Image> &images,
+        const FRVT_QUALITY::QualityMeasureSet &requested,
+        std::vector<FRVT_QUALITY::ImageQualityAssessment> &assessments,
+        std::vector<FRVT::ReturnStatus> &statuses)
+    {
+        assessments.assign(images.size(), ImageQualityAssessment{});
+        statuses.resize(images.size());
+        for (size_t i = 0; i < images.size(); i++) {
+            statuses[i] = this->vectorQuality(images[i], assessments[i]);
+            assessments[i].qAssessments.retain(requested);
+        }
+        return FRVT::ReturnStatus(FRVT::ReturnCode::Success);
+    }
+
     /**
      * @brief
      * Factory method to return a managed pointer to the Interface object.
@@ -256,9 +522,9 @@ extern uint16_t API_MAJOR_VERSION;
 extern uint16_t API_MINOR_VERSION;
 #else /* NIST_EXTERN_API_VERSION */
 /** API major version number. */
-uint16_t API_MAJOR_VERSION{4};
+uint16_t API_MAJOR_VERSION{5};
 /** API minor version number. */
-uint16_t API_MINOR_VERSION{1};
+uint16_t API_MINOR_VERSION{0};
 #endif /* NIST_EXTERN_API_VERSION */
 }
 
@@ -48,6 +48,8 @@ NullImplFRVTQuality::vectorQuality(
     qualityMap[QualityMeasure::SubjectPoseYaw] = dist(rng);
     qualityMap[QualityMeasure::SubjectPosePitch] = dist(rng);
     qualityMap[QualityMeasure::SubjectPoseRoll] = dist(rng);    
+    qualityMap[QualityMeasure::UnifiedQualityScore] =
+        std::uniform_real_distribution<double>(0, 100)(rng);
     FRVT_QUALITY::BoundingBox bb{int16_t(1), int16_t(2), 100, 120};
     assessments.boundingBox = bb;
     assessments.qAssessments = qualityMap;
@@ -0,0 +1,229 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include "frvt_quality.h"
+#include "quality_columns.h"
+#include "util.h"
+
+using namespace std;
+using namespace FRVT_QUALITY;
+
+namespace {
+
+const size_t numMeasures{QualityAssessments::NumMeasures};
+const vector<double> quantiles{0.01, 0.05, 0.25, 0.50, 0.75, 0.95, 0.99};
+
+/* Values and row counts gathered by one reader thread */
+struct Partial {
+    vector<vector<float>> values;
+    uint64_t rows;
+    bool ok;
+
+    Partial() : values(numMeasures), rows{0}, ok{true} {}
+};
+
+/* Summary of one measure across all files */
+struct Summary {
+    uint64_t count;
+    double mean, min, max;
+    vector<double> quantiles;
+    vector<uint64_t> histogram;
+
+    Summary() : count{0}, mean{0}, min{0}, max{0} {}
+};
+
+void
+readFiles(
+    const vector<string> &files,
+    size_t first,
+    size_t stride,
+    Partial &partial)
+{
+    QualityColumns::RowGroup group;
+    for (size_t f = first; f < files.size(); f += stride) {
+        QualityColumns::Reader reader(files[f]);
+        if (!reader.isOpen()) {
+            cerr << "[ERROR] " << files[f] << " is not a columnar quality file." << endl;
+            partial.ok = false;
+            continue;
+        }
+        while (reader.next(group)) {
+            partial.rows += group.size();
+            for (size_t m = 0; m < numMeasures; m++)
+                for (size_t row = 0; row < group.size(); row++)
+                    if (group.isValid(m, row))
+                        partial.values[m].push_back(group.values[m][row]);
+        }
+        if (reader.isTruncated()) {
+            cerr << "[ERROR] " << files[f] << " ends in a truncated row group." << endl;
+            partial.ok = false;
+        }
+    }
+}
+
+/* Linear interpolation between closest ranks of sorted values */
+double
+quantile(
+    const vector<float> &sorted,
+    double q)
+{
+    double pos = q * (sorted.size() - 1);
+    size_t lower = static_cast<size_t>(pos);
+    size_t upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (pos - lower) * (sorted[upper] - sorted[lower]);
+}
+
+void
+summarize(
+    vector<float> &values,
+    unsigned int numBins,
+    Summary &summary)
+{
+    summary.count = values.size();
+    summary.histogram.assign(numBins, 0);
+    if (values.empty())
+        return;
+
+    std::sort(values.begin(), values.end());
+    summary.min = values.front();
+    summary.max = values.back();
+    double sum{0};
+    for (const auto &value : values)
+        sum += value;
+    summary.mean = sum / values.size();
+    for (const auto &q : quantiles)
+        summary.quantiles.push_back(quantile(values, q));
+
+    double width = (summary.max - summary.min) / numBins;
+    for (const auto &value : values) {
+        size_t bin = (width > 0 ? static_cast<size_t>((value - summary.min) / width) : 0);
+        summary.histogram[std::min(bin, static_cast<size_t>(numBins - 1))]++;
+    }
+}
+
+}
+
+void usage(const string &executable)
+{
+    cerr << "Usage: " << executable << " -o outputFile [-t numThreads] "
+            "[-n numBins] file.qcol [file.qcol ...]" << endl;
+    exit(EXIT_FAILURE);
+}
+
+int
+main(
+        int argc,
+        char* argv[])
+{
+    string outputFile;
+    unsigned int numThreads = std::max(1U, std::thread::hardware_concurrency());
+    unsigned int numBins = 20;
+    vector<string> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i],"-o") == 0 && i + 1 < argc)
+            outputFile = argv[++i];
+        else if (strcmp(argv[i],"-t") == 0 && i + 1 < argc)
+            numThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i],"-n") == 0 && i + 1 < argc)
+            numBins = atoi(argv[++i]);
+        else if (argv[i][0] == '-') {
+            cerr << "[ERROR] Unrecognized flag: " << argv[i] << endl;
+            usage(argv[0]);
+        } else
+            files.push_back(argv[i]);
+    }
+    if (outputFile.empty() || files.empty() || numThreads == 0 || numBins == 0)
+        usage(argv[0]);
+    numThreads = std::min<size_t>(numThreads, files.size());
+
+    /* Read all files in one pass, each thread taking every Nth file */
+    vector<Partial> partials(numThreads);
+    vector<std::thread> workers;
+    for (unsigned int t = 0; t < numThreads; t++)
+        workers.emplace_back(readFiles, std::cref(files), t, numThreads,
+            std::ref(partials[t]));
+    for (auto &worker : workers)
+        worker.join();
+    workers.clear();
+
+    uint64_t rows{0};
+    for (auto &partial : partials) {
+        if (!partial.ok)
+            return FAILURE;
+        rows += partial.rows;
+    }
+
+    /* Combine per-thread values, then summarize measures in parallel */
+    vector<vector<float>> values(numMeasures);
+    for (size_t m = 0; m < numMeasures; m++)
+        for (auto &partial : partials) {
+            values[m].insert(values[m].end(), partial.values[m].begin(),
+                partial.values[m].end());
+            vector<float>().swap(partial.values[m]);
+        }
+    vector<Summary> summaries(numMeasures);
+    for (unsigned int t = 0; t < numThreads; t++)
+        workers.emplace_back([&, t] {
+            for (size_t m = t; m < numMeasures; m += numThreads)
+                summarize(values[m], numBins, summaries[m]);
+        });
+    for (auto &worker : workers)
+        worker.join();
+
+    ofstream outputStream(outputFile);
+    if (!outputStream.is_open()) {
+        cerr << "[ERROR] Failed to open stream for " << outputFile << "." << endl;
+        return FAILURE;
+    }
+
+    outputStream << "measure count missing mean min";
+    for (const auto &q : quantiles)
+        outputStream << " p" << std::round(q * 100);
+    outputStream << " max" << endl;
+    for (QualityMeasure e = QualityMeasure::Begin; e != QualityMeasure::End; ++e) {
+        const auto &summary = summaries[static_cast<size_t>(e)];
+        outputStream << e << " " << summary.count << " " << rows - summary.count;
+        if (summary.count == 0) {
+            for (size_t i = 0; i < quantiles.size() + 3; i++)
+                outputStream << " NA";
+        } else {
+            outputStream << " " << summary.mean << " " << summary.min;
+            for (const auto &value : summary.quantiles)
+                outputStream << " " << value;
+            outputStream << " " << summary.max;
+        }
+        outputStream << endl;
+    }
+
+    outputStream << endl << "measure bin lower upper count" << endl;
+    for (QualityMeasure e = QualityMeasure::Begin; e != QualityMeasure::End; ++e) {
+        const auto &summary = summaries[static_cast<size_t>(e)];
+        if (summary.count == 0)
+            continue;
+        double width = (summary.max - summary.min) / numBins;
+        for (unsigned int b = 0; b < numBins; b++)
+            outputStream << e << " " << b << " "
+                << summary.min + b * width << " "
+                << summary.min + (b + 1) * width << " "
+                << summary.histogram[b] << endl;
+    }
+
+    cerr << "[INFO] Aggregated " << rows << " rows from " << files.size()
+            << " files with " << numThreads << " threads." << endl;
+    return SUCCESS;
+}
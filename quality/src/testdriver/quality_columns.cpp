@@ -0,0 +1,218 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#include <cstring>
+
+#include "quality_columns.h"
+
+using namespace std;
+using namespace FRVT;
+using namespace FRVT_QUALITY;
+
+namespace {
+
+const char magic[] = "FQCOL002";
+const size_t magicLength{8};
+const size_t numMeasures{QualityAssessments::NumMeasures};
+
+template<typename T>
+void
+writeColumn(
+    ofstream &stream,
+    const vector<T> &column)
+{
+    stream.write(reinterpret_cast<const char*>(column.data()),
+        column.size() * sizeof(T));
+}
+
+template<typename T>
+bool
+readColumn(
+    ifstream &stream,
+    vector<T> &column,
+    size_t count)
+{
+    column.resize(count);
+    return static_cast<bool>(stream.read(
+        reinterpret_cast<char*>(column.data()), count * sizeof(T)));
+}
+
+void
+writeStrings(
+    ofstream &stream,
+    const vector<string> &column)
+{
+    for (const auto &value : column) {
+        uint32_t length = value.size();
+        stream.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        stream.write(value.data(), length);
+    }
+}
+
+bool
+readStrings(
+    ifstream &stream,
+    vector<string> &column,
+    size_t count)
+{
+    column.resize(count);
+    for (auto &value : column) {
+        uint32_t length;
+        if (!stream.read(reinterpret_cast<char*>(&length), sizeof(length)))
+            return false;
+        value.resize(length);
+        if (!stream.read(&value[0], length))
+            return false;
+    }
+    return true;
+}
+
+}
+
+void
+QualityColumns::RowGroup::clear()
+{
+    this->ids.clear();
+    this->images.clear();
+    this->returnCodes.clear();
+    this->xleft.clear();
+    this->ytop.clear();
+    this->width.clear();
+    this->height.clear();
+    for (size_t m = 0; m < numMeasures; m++) {
+        this->values[m].clear();
+        this->validity[m].clear();
+    }
+}
+
+QualityColumns::Writer::Writer(
+    const string &path,
+    uint32_t rowGroupSize) :
+    stream(path, ios::binary),
+    rowGroupSize{rowGroupSize > 0 ? rowGroupSize : 1}
+{
+    if (!this->stream.is_open())
+        return;
+    uint32_t columns = numMeasures;
+    this->stream.write(magic, magicLength);
+    this->stream.write(reinterpret_cast<const char*>(&columns), sizeof(columns));
+}
+
+QualityColumns::Writer::~Writer()
+{
+    this->close();
+}
+
+void
+QualityColumns::Writer::append(
+    const string &id,
+    const string &image,
+    const ReturnStatus &status,
+    const ImageQualityAssessment &assessment)
+{
+    auto row = this->group.size();
+    this->group.ids.push_back(id);
+    this->group.images.push_back(image);
+    this->group.returnCodes.push_back(
+        static_cast<std::underlying_type<ReturnCode>::type>(status.code));
+    this->group.xleft.push_back(assessment.boundingBox.xleft);
+    this->group.ytop.push_back(assessment.boundingBox.ytop);
+    this->group.width.push_back(assessment.boundingBox.width);
+    this->group.height.push_back(assessment.boundingBox.height);
+
+    const auto &detection = assessment.qAssessments;
+    for (size_t m = 0; m < numMeasures; m++) {
+        auto &validity = this->group.validity[m];
+        if (row % 8 == 0)
+            validity.push_back(0);
+        if (detection.count(QualityMeasure(m))) {
+            validity.back() |= (1 << (row % 8));
+            this->group.values[m].push_back(detection.at(QualityMeasure(m)));
+        } else
+            this->group.values[m].push_back(0);
+    }
+
+    if (this->group.size() == this->rowGroupSize)
+        this->flush();
+}
+
+void
+QualityColumns::Writer::flush()
+{
+    uint32_t numRows = this->group.size();
+    if (numRows == 0 || !this->stream.is_open())
+        return;
+
+    this->stream.write(reinterpret_cast<const char*>(&numRows), sizeof(numRows));
+    writeStrings(this->stream, this->group.ids);
+    writeStrings(this->stream, this->group.images);
+    writeColumn(this->stream, this->group.returnCodes);
+    writeColumn(this->stream, this->group.xleft);
+    writeColumn(this->stream, this->group.ytop);
+    writeColumn(this->stream, this->group.width);
+    writeColumn(this->stream, this->group.height);
+    for (size_t m = 0; m < numMeasures; m++) {
+        writeColumn(this->stream, this->group.validity[m]);
+        writeColumn(this->stream, this->group.values[m]);
+    }
+    this->group.clear();
+}
+
+bool
+QualityColumns::Writer::close()
+{
+    if (!this->stream.is_open())
+        return false;
+    this->flush();
+    this->stream.close();
+    return !this->stream.fail();
+}
+
+QualityColumns::Reader::Reader(const string &path) :
+    stream(path, ios::binary),
+    valid{false},
+    truncated{false}
+{
+    char header[magicLength];
+    uint32_t columns;
+    if (this->stream.read(header, magicLength) &&
+            memcmp(header, magic, magicLength) == 0 &&
+            this->stream.read(reinterpret_cast<char*>(&columns), sizeof(columns)))
+        this->valid = (columns == numMeasures);
+}
+
+bool
+QualityColumns::Reader::next(RowGroup &group)
+{
+    uint32_t numRows;
+    if (!this->valid)
+        return false;
+    if (!this->stream.read(reinterpret_cast<char*>(&numRows), sizeof(numRows))) {
+        /* End of file only if it falls between row groups */
+        this->truncated = (this->stream.gcount() != 0);
+        return false;
+    }
+
+    this->truncated = true;
+    if (!readStrings(this->stream, group.ids, numRows) ||
+            !readStrings(this->stream, group.images, numRows) ||
+            !readColumn(this->stream, group.returnCodes, numRows) ||
+            !readColumn(this->stream, group.xleft, numRows) ||
+            !readColumn(this->stream, group.ytop, numRows) ||
+            !readColumn(this->stream, group.width, numRows) ||
+            !readColumn(this->stream, group.height, numRows))
+        return false;
+    for (size_t m = 0; m < numMeasures; m++)
+        if (!readColumn(this->stream, group.validity[m], (numRows + 7) / 8) ||
+                !readColumn(this->stream, group.values[m], numRows))
+            return false;
+    this->truncated = false;
+    return true;
+}
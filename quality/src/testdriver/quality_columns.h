@@ -0,0 +1,132 @@
+/**
+ * This software was developed at the National Institute of Standards and
+ * Technology (NIST) by employees of the Federal Government in the course
+ * of their official duties. Pursuant to title 17 Section 105 of the
+ * United States Code, this software is not subject to copyright protection
+ * and is in the public domain. NIST assumes no responsibility whatsoever for
+ * its use by other parties, and makes no guarantees, expressed or implied,
+ * about its quality, reliability, or any other characteristic.
+ */
+
+#ifndef QUALITY_COLUMNS_H_
+#define QUALITY_COLUMNS_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "frvt_quality.h"
+
+/**
+ * @brief
+ * Binary columnar encoding of vectorQuality() results.
+ *
+ * @details
+ * A file starts with an 8-byte magic ("FQCOL002") and the number of
+ * measure columns (uint32).  It is followed by row groups, each holding:
+ *   - numRows (uint32)
+ *   - id and image path per row (uint32 length, then bytes)
+ *   - returnCode per row (int32)
+ *   - bounding box xleft, ytop, width, height columns (int16 each)
+ *   - for each QualityMeasure in enum order: a validity bitmap of
+ *     ceil(numRows / 8) bytes (bit i set if row i has the measure),
+ *     then numRows float32 values (0 where not valid)
+ * All integers and floats are in host (little-endian) byte order.
+ */
+namespace QualityColumns {
+
+/** Bytes before the first row group: magic and number of columns */
+const size_t headerSize{8 + sizeof(uint32_t)};
+
+/** Rows and columns of one row group */
+struct RowGroup {
+    std::vector<std::string> ids, images;
+    std::vector<int32_t> returnCodes;
+    std::vector<int16_t> xleft, ytop, width, height;
+    /** values[m][row], indexed by QualityMeasure */
+    std::vector<std::vector<float>> values;
+    /** validity[m] is a bitmap over rows */
+    std::vector<std::vector<uint8_t>> validity;
+
+    RowGroup() :
+        values(FRVT_QUALITY::QualityAssessments::NumMeasures),
+        validity(FRVT_QUALITY::QualityAssessments::NumMeasures)
+        {}
+
+    size_t
+    size() const { return this->ids.size(); }
+
+    bool
+    isValid(size_t measure, size_t row) const
+    { return ((this->validity[measure][row / 8] >> (row % 8)) & 1); }
+
+    void
+    clear();
+};
+
+/** Buffers rows and writes them out a row group at a time */
+class Writer {
+public:
+    /**
+     * @param[in] path
+     * File to create
+     * @param[in] rowGroupSize
+     * Number of rows buffered before a row group is written
+     */
+    Writer(
+        const std::string &path,
+        uint32_t rowGroupSize = 4096);
+
+    /** Flushes any buffered rows. */
+    ~Writer();
+
+    bool
+    isOpen() const { return this->stream.is_open(); }
+
+    void
+    append(
+        const std::string &id,
+        const std::string &image,
+        const FRVT::ReturnStatus &status,
+        const FRVT_QUALITY::ImageQualityAssessment &assessment);
+
+    /** @return false if any write failed */
+    bool
+    close();
+
+private:
+    void
+    flush();
+
+    std::ofstream stream;
+    uint32_t rowGroupSize;
+    RowGroup group;
+};
+
+/** Reads a file written by Writer, one row group at a time */
+class Reader {
+public:
+    explicit Reader(const std::string &path);
+
+    /** @return false if the file could not be opened or is not columnar */
+    bool
+    isOpen() const { return this->valid; }
+
+    /** @return false at end of file or on a truncated row group */
+    bool
+    next(RowGroup &group);
+
+    /** @return true if next() stopped on a truncated row group rather
+     * than at end of file (e.g., a part from a killed worker) */
+    bool
+    isTruncated() const { return this->truncated; }
+
+private:
+    std::ifstream stream;
+    bool valid, truncated;
+};
+
+}
+
+#endif /* QUALITY_COLUMNS_H_ */
@@ -10,26 +10,115 @@
 
 #include <fstream>
 #include <iostream>
+#include <cstdio>
 #include <cstring>
 #include <iterator>
+#include <sstream>
 #include <sys/wait.h>
 #include <unistd.h>
 #include <csignal>
 
 
+#include "execution.h"
 #include "frvt_quality.h"
+#include "io_probe.h"
+#include "perf_counters.h"
+#include "quality_columns.h"
 #include "util.h"
 
 using namespace std;
 using namespace FRVT;
 using namespace FRVT_QUALITY;
 
+/* Look up a QualityMeasure by the name its stream operator prints */
+bool
+parseQualityMeasure(
+    const string &name,
+    QualityMeasure &measure)
+{
+    for (QualityMeasure e = QualityMeasure::Begin; e != QualityMeasure::End; ++e) {
+        ostringstream oss;
+        oss << e;
+        if (oss.str() == name) {
+            measure = e;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Call vectorQualityBatch() and log one line per image, either
+ * as text or, when columnWriter is set, to the columnar output */
+ReturnStatus
+runQualityBatch(
+    std::shared_ptr<Interface> &implPtr,
+    const vector<string> &ids,
+    const vector<string> &imagePaths,
+    const vector<Image> &images,
+    const QualityMeasureSet &requested,
+    vector<ImageQualityAssessment> &assessments,
+    vector<ReturnStatus> &statuses,
+    ofstream &logStream,
+    QualityColumns::Writer *columnWriter)
+{
+    auto ret = perfCall("vectorQualityBatch", [&] { return implPtr->vectorQualityBatch(images, requested, assessments, statuses); });
+    if (ret.code == ReturnCode::NotImplemented)
+        return ret;
+    if (ret.code != ReturnCode::Success) {
+        /* Treat a failed batch as every image failing, with no measures */
+        assessments.assign(images.size(), ImageQualityAssessment());
+        statuses.assign(images.size(), ret);
+    } else if (assessments.size() != images.size() || statuses.size() != images.size()) {
+        cerr << "[ERROR] vectorQualityBatch() returned " << assessments.size() <<
+                " assessments and " << statuses.size() << " statuses for " <<
+                images.size() << " images." << endl;
+        raise(SIGTERM);
+    }
+
+    for (size_t i = 0; i < images.size(); i++) {
+        /* If function is not implemented, clean up and exit */
+        if (statuses[i].code == ReturnCode::NotImplemented)
+            return statuses[i];
+
+        if (columnWriter != nullptr) {
+            assessments[i].qAssessments.retain(requested);
+            columnWriter->append(ids[i], imagePaths[i], statuses[i], assessments[i]);
+            continue;
+        }
+
+        logStream << ids[i] << " "
+            << imagePaths[i] << " "
+            << static_cast<std::underlying_type<ReturnCode>::type>(statuses[i].code) << " ";
+
+        /* Values are formatted into a stack buffer ("%f", as to_string()
+         * would) so that logging does not allocate */
+        const auto &detection = assessments[i].qAssessments;
+        const auto &bb = assessments[i].boundingBox;
+        logStream << bb.xleft << " " << bb.ytop << " " << bb.width << " " << bb.height;
+        char value[64];
+        for (size_t m = 0; m < QualityAssessments::NumMeasures; m++) {
+            if (!requested.test(m))
+                continue;
+            if (detection.count(QualityMeasure(m))) {
+                snprintf(value, sizeof(value), " %f", detection.at(QualityMeasure(m)));
+                logStream << value;
+            } else
+                logStream << " NA";
+        }
+        logStream << '\n';
+    }
+    return ReturnStatus(ReturnCode::Success);
+}
+
 int
 runQuality(
     std::shared_ptr<Interface> &implPtr,
     const string &inputFile,
     const string &outputLog,
-    Action action)
+    Action action,
+    const QualityMeasureSet &requested,
+    unsigned int batchSize,
+    bool columnar)
 {
     /* Read input file */
     ifstream inputStream(inputFile);
@@ -39,55 +128,70 @@ runQuality(
     }
 
     /* Open output log for writing */
-    ofstream logStream(outputLog);
-    if (!logStream.is_open()) {
-        cerr << "[ERROR] Failed to open stream for " << outputLog << "." << endl;
-        raise(SIGTERM);
+    ofstream logStream;
+    std::unique_ptr<QualityColumns::Writer> columnWriter;
+    if (columnar) {
+        columnWriter.reset(new QualityColumns::Writer(outputLog));
+        if (!columnWriter->isOpen()) {
+            cerr << "[ERROR] Failed to open stream for " << outputLog << "." << endl;
+            raise(SIGTERM);
+        }
+    } else {
+        logStream.open(outputLog);
+        if (!logStream.is_open()) {
+            cerr << "[ERROR] Failed to open stream for " << outputLog << "." << endl;
+            raise(SIGTERM);
+        }
     }
 
-    /* header */
-    if (action == Action::VectorQ) {
+    /* header; only the requested measures get a column */
+    if (action == Action::VectorQ && !columnar) {
         logStream << "id image returnCode bb_xleft bb_ytop bb_width bb_height ";
         for (QualityMeasure e = QualityMeasure::Begin; e != QualityMeasure::End; ++e) {
-            logStream << e << " "; 
+            if (requested.test(static_cast<size_t>(e)))
+                logStream << e << " ";
         }
         logStream << endl;
     }       
 
+    if (batchSize == 0)
+        batchSize = 1;
+
+    vector<string> ids, imagePaths;
+    vector<Image> images;
+    vector<ImageQualityAssessment> assessments;
+    vector<ReturnStatus> statuses;
     string id, imagePath, desc;
     ReturnStatus ret;
-    while (inputStream >> id >> imagePath >> desc) {
-        Image image;
-        if (!readImage(imagePath, image)) {
-            cerr << "[ERROR] Failed to load image file: " << imagePath << "." << endl;
-            raise(SIGTERM);
+    while (true) {
+        bool haveLine = static_cast<bool>(inputStream >> id >> imagePath >> desc);
+        if (haveLine) {
+            Image image;
+            if (!readImage(imagePath, image)) {
+                cerr << "[ERROR] Failed to load image file: " << imagePath << "." << endl;
+                raise(SIGTERM);
+            }
+            image.description = toImageDescription(desc);
+            ids.push_back(id);
+            imagePaths.push_back(imagePath);
+            images.push_back(image);
         }
-        image.description = mapStringToImgLabel[desc];
 
-        Image face{image};
-        ImageQualityAssessment assessments;
-        if (action == Action::VectorQ)
-            ret = implPtr->vectorQuality(face, assessments);
-        
-        /* If function is not implemented, clean up and exit */
-        if (ret.code == ReturnCode::NotImplemented) {
-            break;
-        }
+        if (images.size() == batchSize || (!haveLine && !images.empty())) {
+            if (action == Action::VectorQ)
+                ret = runQualityBatch(implPtr, ids, imagePaths, images,
+                        requested, assessments, statuses, logStream,
+                        columnWriter.get());
+            ids.clear();
+            imagePaths.clear();
+            images.clear();
 
-        if (action == Action::VectorQ) {
-            logStream << id << " "
-                << imagePath << " "
-                << static_cast<std::underlying_type<ReturnCode>::type>(ret.code) << " ";
-
-            auto detection = assessments.qAssessments;
-            auto bb = assessments.boundingBox; 
-            logStream << (to_string(bb.xleft)) << " " << (to_string(bb.ytop)) << " " << (to_string(bb.width)) << " " << (to_string(bb.height));
-            for (QualityMeasure e = QualityMeasure::Begin; e != QualityMeasure::End; ++e) {
-                auto it = detection.find(e);
-                logStream << " " << ((it != detection.end()) ? to_string(it->second) : "NA");
-            }
-            logStream << endl;
+            /* If function is not implemented, clean up and exit */
+            if (ret.code == ReturnCode::NotImplemented)
+                break;
         }
+        if (!haveLine)
+            break;
     }
     inputStream.close();
 
@@ -95,6 +199,11 @@ runQuality(
     if( remove(inputFile.c_str()) != 0 )
         cerr << "Error deleting file: " << inputFile << endl;
 
+    if (columnWriter && !columnWriter->close()) {
+        cerr << "[ERROR] Failed to write " << outputLog << "." << endl;
+        raise(SIGTERM);
+    }
+
     if (ret.code == ReturnCode::NotImplemented) {
         /* Remove the output file */
         logStream.close();
@@ -105,10 +214,25 @@ runQuality(
     return SUCCESS;
 }
 
+/* --io-only: load the image of one input line as runQuality() does,
+ * without calling the implementation */
+void
+loadOnly(
+        const string &line,
+        IOProbe &probe)
+{
+    auto tokens = split(line, ' ');
+    if (tokens.size() < 2)
+        return;
+    Image image;
+    probe.load(tokens[1], [&] { return readImage(tokens[1], image); });
+}
+
 void usage(const string &executable)
 {
     cerr << "Usage: " << executable << " -c configDir "
-            "-o outputDir -h outputStem -i inputFile -t numForks" << endl;
+            "-o outputDir -h outputStem -i inputFile " << executionUsage() << " "
+            "[-m measure,measure,...] [-b batchSize] [-f text|columnar]" << endl;
     exit(EXIT_FAILURE);
 }
 
@@ -117,10 +241,9 @@ main(
         int argc,
         char* argv[])
 {
-    auto exitStatus = SUCCESS;
 
-    uint16_t currAPIMajorVersion{4},
-        currAPIMinorVersion{1},
+    uint16_t currAPIMajorVersion{5},
+        currAPIMinorVersion{0},
         currStructsMajorVersion{3},
         currStructsMinorVersion{0};
 
@@ -156,7 +279,10 @@ main(
         outputDir{"output"},
         outputFileStem{"stem"},
         inputFile;
-    int numForks = 1;
+    ExecutionOptions execution;
+    QualityMeasureSet requested;
+    unsigned int batchSize = 1;
+    bool columnar = false;
 
     for (int i = 0; i < argc - requiredArgs; i++) {
         if (strcmp(argv[requiredArgs+i],"-c") == 0)
@@ -167,9 +293,25 @@ main(
             outputFileStem = argv[requiredArgs+(++i)];
         else if (strcmp(argv[requiredArgs+i],"-i") == 0)
             inputFile = argv[requiredArgs+(++i)];
-        else if (strcmp(argv[requiredArgs+i],"-t") == 0)
-            numForks = atoi(argv[requiredArgs+(++i)]);
-        else {
+        else if (strcmp(argv[requiredArgs+i],"-m") == 0) {
+            for (const auto &name : split(argv[requiredArgs+(++i)], ',')) {
+                QualityMeasure measure;
+                if (!parseQualityMeasure(name, measure)) {
+                    cerr << "[ERROR] Unknown quality measure: " << name << endl;
+                    usage(argv[0]);
+                }
+                requested.set(static_cast<size_t>(measure));
+            }
+        } else if (strcmp(argv[requiredArgs+i],"-b") == 0)
+            batchSize = atoi(argv[requiredArgs+(++i)]);
+        else if (strcmp(argv[requiredArgs+i],"-f") == 0) {
+            string formatstr{argv[requiredArgs+(++i)]};
+            if (formatstr != "text" && formatstr != "columnar") {
+                cerr << "[ERROR] Unknown output format: " << formatstr << endl;
+                usage(argv[0]);
+            }
+            columnar = (formatstr == "columnar");
+        } else if (!parseExecutionFlag(argc - requiredArgs, argv + requiredArgs, i, execution)) {
             cerr << "[ERROR] Unrecognized flag: " << argv[requiredArgs+i] << endl;;
             usage(argv[0]);
         }
@@ -184,68 +326,46 @@ main(
             usage(argv[0]);
     }
 
-    /* Get implementation pointer */
-    auto implPtr = Interface::getImplementation();
-    /* Initialization */
-    auto ret = implPtr->initialize(configDir);
-    if (ret.code != ReturnCode::Success) {
-        cerr << "[ERROR] initialize() returned error: "
-                << ret.code << "." << endl;
-        return FAILURE;
-    }
-
-    /* Split input file into appropriate number of splits */
-    vector<string> inputFileVector;
-    if (splitInputFile(inputFile, outputDir, numForks, inputFileVector) != SUCCESS) {
-        cerr << "[ERROR] An error occurred with processing the input file." << endl;
-        return FAILURE;
-    }
+    /* By default, request every quality measure */
+    if (requested.none())
+        requested.set();
 
-    bool parent = false;
-    int i = 0;
-    for (auto &inputFile : inputFileVector) {
-        /* Fork */
-        switch(fork()) {
-        case 0: /* Child */
-            switch (action) {
-                case Action::VectorQ:
-                    return runQuality(
-                        implPtr,
-                        inputFile,
-                        outputDir + "/" + outputFileStem + ".log." + to_string(i),
-                        action);
-                default:
-                    return FAILURE;
-            }
-        case -1: /* Error */
-        cerr << "Problem forking" << endl;
-        break;
-        default: /* Parent */
-            parent = true;
-            break;
+    /* Get implementation pointer; --io-only never calls it */
+    std::shared_ptr<Interface> implPtr;
+    if (!execution.ioOnly) {
+        implPtr = Interface::getImplementation();
+        /* Initialization */
+        auto ret = implPtr->initialize(configDir);
+        if (ret.code != ReturnCode::Success) {
+            cerr << "[ERROR] initialize() returned error: "
+                    << ret.code << "." << endl;
+            return FAILURE;
         }
-        i++;
     }
 
-    /* Parent -- wait for children */
-    if (parent) {
-        while (numForks > 0) {
-            int stat_val;
-            pid_t cpid;
-
-            cpid = wait(&stat_val);
-            if (WIFEXITED(stat_val)) { exitStatus = WEXITSTATUS(stat_val); }
-            else if (WIFSIGNALED(stat_val)) {
-                cerr << "PID " << cpid << " exited due to signal " <<
-                        WTERMSIG(stat_val) << endl;
-                exitStatus = FAILURE;
-            } else {
-                cerr << "PID " << cpid << " exited with unknown status." << endl;
-                exitStatus = FAILURE;
-            }
-            numForks--;
+    /* Run the requested action on one input split */
+    auto runAction = [&](const string &inputFile, int i) -> int {
+        if (execution.ioOnly)
+            return loadInputOnly(inputFile, ioProbePath(outputDir, i), loadOnly);
+        switch (action) {
+            case Action::VectorQ:
+                return runQuality(
+                    implPtr,
+                    inputFile,
+                    outputDir + "/" + outputFileStem +
+                        (columnar ? ".qcol." : ".log.") + to_string(i),
+                    action,
+                    requested,
+                    batchSize,
+                    columnar);
+            default:
+                return FAILURE;
         }
-    }
+    };
 
-    return exitStatus;
+    /* Columnar parts each repeat the file header instead of a header line */
+    MergeOutput output(outputDir + "/" + outputFileStem + (columnar ? ".qcol" : ".log"),
+        (columnar ? MergeFormat::Concatenate : MergeFormat::Log),
+        (columnar ? QualityColumns::headerSize : 0));
+    return runWorkers(inputFile, outputDir, execution, runAction, {output});
 }